@@ -1,23 +1,68 @@
 #include "AST.h"
+#include "dtoa.h"
+#include "json.h"
+#include <float.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+static _Thread_local Arena *ast_arena = NULL;
+
+Arena *ast_use_arena(Arena *arena)
+{
+    Arena *previous = ast_arena;
+    ast_arena = arena;
+    return previous;
+}
 AST *init_ast(AST_Type type)
 {
-    AST *ast = calloc(1, sizeof(AST));
+    AST *ast;
+    if (ast_arena)
+    {
+        ast = arena_alloc(ast_arena, sizeof(AST));
+        memset(ast, 0, sizeof(AST));
+        ast->flags = AST_FLAG_ARENA;
+    }
+    else
+    {
+        ast = calloc(1, sizeof(AST));
+    }
     if (type == AST_COMPOUND || type == AST_SEQUENCEEXPR)
     {
-        init_array(&ast->childs);
+        init_small_array(&ast->childs);
     }
     ast->type = type;
+    ast->refcount = 1;
     return ast;
 }
+char *ast_token_text(Token token)
+{
+    if (ast_arena == NULL)
+        return token_text(token);
+    if (token.type == TOKEN_EOF)
+        return arena_strndup(ast_arena, "end of file", 11);
+    return arena_strndup(ast_arena, token.start, token.length);
+}
 size_t ast_push(AST *ast, AST *child)
 {
     size_t i = array_size(&ast->childs);
-    array_push(&ast->childs, child);
+    if ((ast->flags & AST_FLAG_ARENA) && ast->childs.count >= ast->childs.capacity)
+    {
+        uint32_t capacity = ast->childs.capacity * 2;
+        AST **items = arena_alloc(ast_arena, capacity * sizeof(AST *));
+        memcpy(items, ast->childs.items, i * sizeof(AST *));
+        ast->childs.items = items;
+        ast->childs.capacity = capacity;
+    }
+    small_array_push(&ast->childs, child);
     return i;
 }
+// arena children are freed with their arena, so only heap ones are trimmed.
+void ast_shrink(AST *ast)
+{
+    if (ast && !(ast->flags & AST_FLAG_ARENA))
+        small_array_shrink(&ast->childs);
+}
 char *ast_to_str(AST *ast)
 {
     return ast_type_to_str(ast->type);
@@ -62,130 +107,346 @@ char *ast_type_to_str(int type)
         return "UNKNOWN";
     }
 }
-char *ast_to_json(AST *ast)
+typedef struct
 {
-    if (ast == NULL)
-        return NULL;
-    char *c = calloc(2, sizeof(char));
-    strcpy(c, "{");
-    char *type_key = "\"type\": \"AST_%s\"";
-    char *type = calloc(strlen(type_key) + strlen(ast_type_to_str(ast->type)) + 1, sizeof(char));
-    sprintf(type, type_key, ast_type_to_str(ast->type));
-    c = realloc(c, strlen(c) + strlen(type) + 1 * sizeof(char));
-    strcat(c, type);
-    free(type);
+    AST **nodes;
+    size_t *ids;
+    size_t count;
+    size_t capacity;
+} AST_JsonRefs;
 
-    if (ast->name)
-    {
-        char *name_key = ",\"name\": \"%s\"";
-        char *name = calloc(strlen(name_key) + strlen(ast->name) + 1, sizeof(char));
-        sprintf(name, name_key, ast->name);
-        c = realloc(c, strlen(c) + strlen(name) + 1 * sizeof(char));
-        strcat(c, name);
-        free(name);
-    }
-    if ((ast->type == AST_NUMBER))
-    {
-        char str[50];
-        sprintf(str, "%f", ast->number);
-        size_t digits = strlen(str);
-        char *int_value_key = ",\"number\": \"%f\"";
-        char *number = calloc(strlen(int_value_key) + digits + 1, sizeof(char));
-        sprintf(number, int_value_key, ast->number);
-        c = (char *)realloc(c, strlen(c) + strlen(number) + 1 * sizeof(char));
-        strcat(c, number);
-        free(number);
-    }
+typedef struct
+{
+    StrBuf *out;
+    AST_JsonOptions *options;
+    AST_JsonRefs refs;
+} AST_JsonWriter;
 
-    if (ast->left != NULL)
+static size_t ast_ref_slot(AST_JsonRefs *refs, AST *ast)
+{
+    size_t mask = refs->capacity - 1;
+    size_t slot = (size_t)(((uintptr_t)ast >> 4) * 0x9E3779B97F4A7C15ULL) & mask;
+    while (refs->nodes[slot] != NULL && refs->nodes[slot] != ast)
+        slot = (slot + 1) & mask;
+    return slot;
+}
+static size_t ast_ref_lookup(AST_JsonRefs *refs, AST *ast)
+{
+    if (refs->capacity == 0)
+        return 0;
+    size_t slot = ast_ref_slot(refs, ast);
+    return refs->nodes[slot] ? refs->ids[slot] : 0;
+}
+static size_t ast_ref_add(AST_JsonRefs *refs, AST *ast)
+{
+    if ((refs->count + 1) * 2 > refs->capacity)
     {
-        char *left_key = ",\"left\": ";
-        c = realloc(c, strlen(c) + strlen(left_key) + 1 * sizeof(char));
-        strcat(c, left_key);
-        AST *left = ast->left;
-        char *temp = ast_to_json(left);
-        if (temp)
+        AST_JsonRefs grown = {
+            .capacity = refs->capacity ? refs->capacity * 2 : 64,
+        };
+        grown.nodes = calloc(grown.capacity, sizeof(AST *));
+        grown.ids = calloc(grown.capacity, sizeof(size_t));
+        for (size_t i = 0; i < refs->capacity; i++)
         {
-            c = realloc(c, strlen(c) + strlen(temp) + 1 * sizeof(char));
-            strcat(c, temp);
-            free(temp);
+            if (refs->nodes[i] == NULL)
+                continue;
+            size_t slot = ast_ref_slot(&grown, refs->nodes[i]);
+            grown.nodes[slot] = refs->nodes[i];
+            grown.ids[slot] = refs->ids[i];
         }
+        grown.count = refs->count;
+        free(refs->nodes);
+        free(refs->ids);
+        *refs = grown;
     }
-    if (ast->right != NULL)
+    size_t slot = ast_ref_slot(refs, ast);
+    refs->nodes[slot] = ast;
+    refs->ids[slot] = ++refs->count;
+    return refs->count;
+}
+static void ast_json_fields(AST_JsonWriter *writer, AST *ast);
+static void ast_json_node(AST_JsonWriter *writer, AST *ast)
+{
+    StrBuf *out = writer->out;
+    if (writer->options && writer->options->share_refs && ast->refcount > 1)
     {
-        char *right_key = ",\"right\": ";
-        c = realloc(c, strlen(c) + strlen(right_key) + 1 * sizeof(char));
-        strcat(c, right_key);
-        AST *right = ast->right;
-        char *temp = ast_to_json(right);
-        if (temp)
+        size_t id = ast_ref_lookup(&writer->refs, ast);
+        if (id)
         {
-            c = realloc(c, strlen(c) + strlen(temp) + 1 * sizeof(char));
-            strcat(c, temp);
-            free(temp);
+            strbuf_printf(out, "{\"ref\": %zu}", id);
+            return;
         }
+        id = ast_ref_add(&writer->refs, ast);
+        strbuf_printf(out, "{\"type\": \"AST_%s\",\"id\": %zu", ast_type_to_str(ast->type), id);
     }
-    if (ast->value != NULL)
+    else
     {
-        char *value = ",\"value\": ";
-        c = realloc(c, strlen(c) + strlen(value) + 1 * sizeof(char));
-        strcat(c, value);
-        char *temp = ast_to_json(ast->value);
-        if (temp)
-        {
-            c = realloc(c, strlen(c) + strlen(temp) + 1 * sizeof(char));
-            strcat(c, temp);
-            free(temp);
-        }
+        strbuf_printf(out, "{\"type\": \"AST_%s\"", ast_type_to_str(ast->type));
     }
+    ast_json_fields(writer, ast);
     if (array_size(&ast->childs) != 0)
     {
-        char *children = ",\"children\": [";
-        c = realloc(c, strlen(c) + strlen(children) + 1 * sizeof(char));
-        strcat(c, children);
+        strbuf_puts(out, ",\"children\": [");
         for (size_t i = 0; i < array_size(&ast->childs); i++)
         {
             AST *child = array_at(&ast->childs, i);
             if (child)
             {
-                char *temp = ast_to_json(child);
-                if (temp)
-                {
-                    c = realloc(c, strlen(c) + strlen(temp) + 1 * sizeof(char));
-                    strcat(c, temp);
-                    free(temp);
-                }
+                ast_json_node(writer, child);
                 if (i != array_size(&ast->childs) - 1)
-                {
-                    c = realloc(c, strlen(c) + 2 * sizeof(char));
-                    strcat(c, ",");
-                }
+                    strbuf_putc(out, ',');
             }
         }
-        c = realloc(c, strlen(c) + 2 * sizeof(char));
-        strcat(c, "]");
+        strbuf_putc(out, ']');
+    }
+    strbuf_putc(out, '}');
+}
+static void ast_json_label(StrBuf *out, AST *ast)
+{
+    if (ast->name)
+    {
+        strbuf_puts(out, ",\"name\": ");
+        json_put_string(out, ast->name, strlen(ast->name));
+    }
+    if (ast->type == AST_NUMBER)
+    {
+        strbuf_puts(out, ",\"number\": ");
+        strbuf_reserve(out, DTOA_BUFFER_SIZE);
+        out->length += dtoa_shortest(ast->number, out->data + out->length);
+    }
+}
+// everything after "type" except the children.
+static void ast_json_fields(AST_JsonWriter *writer, AST *ast)
+{
+    StrBuf *out = writer->out;
+    ast_json_label(out, ast);
+    if (ast->left != NULL)
+    {
+        strbuf_puts(out, ",\"left\": ");
+        ast_json_node(writer, ast->left);
+    }
+    if (ast->right != NULL)
+    {
+        strbuf_puts(out, ",\"right\": ");
+        ast_json_node(writer, ast->right);
+    }
+    if (ast->value != NULL)
+    {
+        strbuf_puts(out, ",\"value\": ");
+        ast_json_node(writer, ast->value);
+    }
+}
+void ast_write_json(StrBuf *out, AST *ast, AST_JsonOptions *options)
+{
+    if (ast == NULL)
+        return;
+    AST_JsonWriter writer = {
+        .out = out,
+        .options = options,
+    };
+    ast_json_node(&writer, ast);
+    free(writer.refs.nodes);
+    free(writer.refs.ids);
+}
+void ast_write_json_label(StrBuf *out, AST *ast)
+{
+    strbuf_printf(out, "{\"type\": \"AST_%s\"", ast_type_to_str(ast->type));
+    ast_json_label(out, ast);
+}
+char *ast_to_json(AST *ast)
+{
+    if (ast == NULL)
+        return NULL;
+    StrBuf out = init_strbuf();
+    ast_write_json(&out, ast, NULL);
+    return strbuf_detach(&out);
+}
+typedef struct
+{
+    StrBuf *out;
+    AST_CborOptions *options;
+    AST_JsonRefs refs;
+} AST_CborWriter;
+
+enum
+{
+    CBOR_UNSIGNED = 0,
+    CBOR_TEXT = 3,
+    CBOR_ARRAY = 4,
+    CBOR_MAP = 5,
+    CBOR_TAG = 6,
+};
+#define CBOR_TAG_SHAREABLE 28
+#define CBOR_TAG_SHAREDREF 29
+#define CBOR_FLUSH_SIZE (64 * 1024)
+
+static void ast_cbor_head(StrBuf *out, unsigned major, uint64_t value)
+{
+    char head[9];
+    size_t length;
+    char type = (char)(major << 5);
+    if (value < 24)
+    {
+        head[0] = (char)(type | (char)value);
+        length = 1;
+    }
+    else
+    {
+        size_t bytes = value <= 0xFF ? 1 : value <= 0xFFFF ? 2 : value <= 0xFFFFFFFF ? 4 : 8;
+        head[0] = (char)(type | (bytes == 1 ? 24 : bytes == 2 ? 25 : bytes == 4 ? 26 : 27));
+        for (size_t i = 0; i < bytes; i++)
+            head[1 + i] = (char)(value >> (8 * (bytes - 1 - i)));
+        length = 1 + bytes;
+    }
+    strbuf_append(out, head, length);
+}
+static void ast_cbor_text(StrBuf *out, const char *text, size_t length)
+{
+    ast_cbor_head(out, CBOR_TEXT, length);
+    strbuf_append(out, text, length);
+}
+// numbers that a float holds exactly take the 5-byte form, the rest stay 9-byte doubles.
+static void ast_cbor_number(StrBuf *out, double number)
+{
+    char head[9];
+    // converting a finite double outside the float range is undefined, so those always take 9 bytes.
+    int fits = isnan(number) || isinf(number) || fabs(number) <= FLT_MAX;
+    float narrow = fits ? (float)number : 0.0f;
+    if (fits && ((double)narrow == number || isnan(number)))
+    {
+        uint32_t bits;
+        memcpy(&bits, &narrow, sizeof(bits));
+        head[0] = (char)0xFA;
+        for (size_t i = 0; i < 4; i++)
+            head[1 + i] = (char)(bits >> (8 * (3 - i)));
+        strbuf_append(out, head, 5);
+        return;
+    }
+    uint64_t bits;
+    memcpy(&bits, &number, sizeof(bits));
+    head[0] = (char)0xFB;
+    for (size_t i = 0; i < 8; i++)
+        head[1 + i] = (char)(bits >> (8 * (7 - i)));
+    strbuf_append(out, head, 9);
+}
+static void ast_cbor_key(AST_CborWriter *writer, unsigned index, const char *key)
+{
+    if (writer->options && writer->options->integer_keys)
+        ast_cbor_head(writer->out, CBOR_UNSIGNED, index);
+    else
+        ast_cbor_text(writer->out, key, strlen(key));
+}
+static void ast_cbor_node(AST_CborWriter *writer, AST *ast)
+{
+    StrBuf *out = writer->out;
+    if (writer->options && writer->options->flush && out->length >= CBOR_FLUSH_SIZE)
+    {
+        fwrite(out->data, 1, out->length, writer->options->flush);
+        strbuf_reset(out);
+    }
+    if (writer->options && writer->options->share_refs && ast->refcount > 1)
+    {
+        size_t id = ast_ref_lookup(&writer->refs, ast);
+        if (id)
+        {
+            ast_cbor_head(out, CBOR_TAG, CBOR_TAG_SHAREDREF);
+            ast_cbor_head(out, CBOR_UNSIGNED, id - 1);
+            return;
+        }
+        ast_ref_add(&writer->refs, ast);
+        ast_cbor_head(out, CBOR_TAG, CBOR_TAG_SHAREABLE);
+    }
+
+    size_t children = 0;
+    for (size_t i = 0; i < array_size(&ast->childs); i++)
+        children += array_at(&ast->childs, i) != NULL;
+    int fields = 1 + (ast->name != NULL) + (ast->type == AST_NUMBER) + (ast->left != NULL) + (ast->right != NULL) +
+                 (ast->value != NULL) + (children != 0);
+    ast_cbor_head(out, CBOR_MAP, (uint64_t)fields);
+
+    char type[32];
+    int type_length = snprintf(type, sizeof(type), "AST_%s", ast_type_to_str(ast->type));
+    ast_cbor_key(writer, 0, "type");
+    ast_cbor_text(out, type, (size_t)type_length);
+    if (ast->name)
+    {
+        ast_cbor_key(writer, 1, "name");
+        ast_cbor_text(out, ast->name, strlen(ast->name));
+    }
+    if (ast->type == AST_NUMBER)
+    {
+        ast_cbor_key(writer, 2, "number");
+        ast_cbor_number(out, ast->number);
+    }
+    if (ast->left != NULL)
+    {
+        ast_cbor_key(writer, 3, "left");
+        ast_cbor_node(writer, ast->left);
+    }
+    if (ast->right != NULL)
+    {
+        ast_cbor_key(writer, 4, "right");
+        ast_cbor_node(writer, ast->right);
+    }
+    if (ast->value != NULL)
+    {
+        ast_cbor_key(writer, 5, "value");
+        ast_cbor_node(writer, ast->value);
+    }
+    if (children != 0)
+    {
+        ast_cbor_key(writer, 6, "children");
+        ast_cbor_head(out, CBOR_ARRAY, children);
+        for (size_t i = 0; i < array_size(&ast->childs); i++)
+        {
+            AST *child = array_at(&ast->childs, i);
+            if (child)
+                ast_cbor_node(writer, child);
+        }
     }
-    c = realloc(c, strlen(c) + 2 * sizeof(char));
-    strcat(c, "}");
-    return c;
+}
+void ast_write_cbor(StrBuf *out, AST *ast, AST_CborOptions *options)
+{
+    if (ast == NULL)
+        return;
+    AST_CborWriter writer = {
+        .out = out,
+        .options = options,
+    };
+    ast_cbor_node(&writer, ast);
+    if (options && options->flush)
+    {
+        fwrite(out->data, 1, out->length, options->flush);
+        strbuf_reset(out);
+    }
+    free(writer.refs.nodes);
+    free(writer.refs.ids);
+}
+void ast_print_with(AST *root, AST_JsonOptions *options)
+{
+    StrBuf out = init_strbuf();
+    ast_write_json(&out, root, options);
+    fprintf(stdout, "%s\n", out.data ? out.data : "(null)");
+    strbuf_free(&out);
 }
 void ast_print(AST *root)
 {
-    char *temp = ast_to_json(root);
-    fprintf(stdout, "%s\n", temp);
-    free(temp);
+    ast_print_with(root, NULL);
 }
 void ast_free(AST *ast)
 {
     if (!ast)
         return;
+    if (ast->flags & AST_FLAG_ARENA)
+        return;
+    if (--ast->refcount > 0)
+        return;
     for (size_t i = 0; i < array_size(&ast->childs); i++)
     {
         AST *child = array_at(&ast->childs, i);
         ast_free(child);
     }
-    if (array_size(&ast->childs))
-        array_free(&ast->childs);
+    small_array_free(&ast->childs);
     if (ast->value)
         ast_free(ast->value);
     if (ast->left)
@@ -0,0 +1,466 @@
+#define _POSIX_C_SOURCE 200809L
+#include "aot.h"
+#include "eval.h"
+#include "dtoa.h"
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define AOT_DEFAULT_PREFIX "expr_"
+
+// every subexpression lands in its own temporary, so side effects happen left to right exactly as in eval_ast.
+typedef struct
+{
+    StrBuf *out;
+    const EvalSignature *signature;
+    size_t temps;
+    int depth;
+} AotWriter;
+
+// lines only ever hold temporaries, parameters and builtin names, so they stay short.
+static void aot_line(AotWriter *writer, const char *format, ...)
+{
+    for (int i = 0; i < writer->depth; i++)
+        strbuf_puts(writer->out, "    ");
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    strbuf_puts(writer->out, line);
+    strbuf_putc(writer->out, '\n');
+}
+static void aot_put_c_string(StrBuf *out, const char *text)
+{
+    strbuf_putc(out, '"');
+    for (const unsigned char *c = (const unsigned char *)text; *c; c++)
+    {
+        if (*c >= 0x20 && *c < 0x7f && *c != '"' && *c != '\\' && *c != '?')
+            strbuf_putc(out, (char)*c);
+        else
+            strbuf_printf(out, "\\%03o", *c);
+    }
+    strbuf_putc(out, '"');
+}
+static size_t aot_node(AotWriter *writer, AST *ast);
+static size_t aot_binary(AotWriter *writer, AST *ast)
+{
+    EvalOp op = eval_op(ast);
+    if (op == EVAL_OP_ASSIGN)
+    {
+        size_t right = aot_node(writer, ast->right);
+        aot_line(writer, "p%zu = t%zu;", eval_param(writer->signature, ast->left->name), right);
+        return right;
+    }
+    size_t left = aot_node(writer, ast->left);
+    if (op == EVAL_OP_AND || op == EVAL_OP_OR)
+    {
+        size_t result = writer->temps++;
+        aot_line(writer, "double t%zu = %d;", result, op == EVAL_OP_OR);
+        aot_line(writer, "if (t%zu %s 0)", left, op == EVAL_OP_AND ? "!=" : "==");
+        aot_line(writer, "{");
+        writer->depth++;
+        size_t right = aot_node(writer, ast->right);
+        aot_line(writer, "t%zu = t%zu != 0;", result, right);
+        writer->depth--;
+        aot_line(writer, "}");
+        return result;
+    }
+    size_t right = aot_node(writer, ast->right);
+    size_t result = writer->temps++;
+    const char *infix = NULL;
+    switch (op)
+    {
+    case EVAL_OP_ADD:
+        infix = "+";
+        break;
+    case EVAL_OP_SUB:
+        infix = "-";
+        break;
+    case EVAL_OP_MUL:
+        infix = "*";
+        break;
+    case EVAL_OP_DIV:
+        infix = "/";
+        break;
+    case EVAL_OP_EQ:
+        infix = "==";
+        break;
+    case EVAL_OP_NE:
+        infix = "!=";
+        break;
+    case EVAL_OP_LT:
+        infix = "<";
+        break;
+    case EVAL_OP_LE:
+        infix = "<=";
+        break;
+    case EVAL_OP_GT:
+        infix = ">";
+        break;
+    case EVAL_OP_GE:
+        infix = ">=";
+        break;
+    case EVAL_OP_MOD:
+        aot_line(writer, "double t%zu = fmod(t%zu, t%zu);", result, left, right);
+        return result;
+    case EVAL_OP_BIT_AND:
+        aot_line(writer, "double t%zu = (double)(pratt_int(t%zu) & pratt_int(t%zu));", result, left, right);
+        return result;
+    case EVAL_OP_BIT_OR:
+        aot_line(writer, "double t%zu = (double)(pratt_int(t%zu) | pratt_int(t%zu));", result, left, right);
+        return result;
+    case EVAL_OP_SHL:
+        aot_line(writer, "double t%zu = (double)(int64_t)((uint64_t)pratt_int(t%zu) << (pratt_int(t%zu) & 63));",
+                 result, left, right);
+        return result;
+    default:
+        aot_line(writer, "double t%zu = (double)(pratt_int(t%zu) >> (pratt_int(t%zu) & 63));", result, left, right);
+        return result;
+    }
+    aot_line(writer, "double t%zu = t%zu %s t%zu;", result, left, infix, right);
+    return result;
+}
+static size_t aot_node(AotWriter *writer, AST *ast)
+{
+    size_t result;
+    switch (ast->type)
+    {
+    case AST_NUMBER:
+    {
+        result = writer->temps++;
+        char number[DTOA_BUFFER_SIZE];
+        if (isfinite(ast->number))
+        {
+            // integral values come out without a dot, and from 2^64 up such a literal has no integer type in C.
+            size_t length = dtoa_shortest(ast->number, number);
+            if (strpbrk(number, ".e") == NULL)
+                strcpy(number + length, ".0");
+        }
+        else
+            strcpy(number, ast->number > 0 ? "HUGE_VAL" : ast->number < 0 ? "-HUGE_VAL" : "NAN");
+        aot_line(writer, "double t%zu = %s;", result, number);
+        return result;
+    }
+    case AST_TRUE:
+    case AST_FALSE:
+    case AST_NULL:
+        result = writer->temps++;
+        aot_line(writer, "double t%zu = %d;", result, ast->type == AST_TRUE);
+        return result;
+    case AST_ID:
+        result = writer->temps++;
+        aot_line(writer, "double t%zu = p%zu;", result, eval_param(writer->signature, ast->name));
+        return result;
+    case AST_BINARY:
+        return aot_binary(writer, ast);
+    case AST_UNARY:
+    case AST_POSTFIX:
+    {
+        EvalOp op = eval_op(ast);
+        if (op == EVAL_OP_INC || op == EVAL_OP_DEC)
+        {
+            const char *step = op == EVAL_OP_INC ? "++" : "--";
+            size_t param = eval_param(writer->signature, ast->value->name);
+            result = writer->temps++;
+            if (ast->type == AST_POSTFIX)
+                aot_line(writer, "double t%zu = p%zu%s;", result, param, step);
+            else
+                aot_line(writer, "double t%zu = %sp%zu;", result, step, param);
+            return result;
+        }
+        size_t value = aot_node(writer, ast->value);
+        result = writer->temps++;
+        if (op == EVAL_OP_NEG)
+            aot_line(writer, "double t%zu = -t%zu;", result, value);
+        else if (op == EVAL_OP_NOT)
+            aot_line(writer, "double t%zu = t%zu == 0;", result, value);
+        else
+            aot_line(writer, "double t%zu = (double)~pratt_int(t%zu);", result, value);
+        return result;
+    }
+    case AST_TERNARY:
+    {
+        size_t condition = aot_node(writer, ast->value);
+        result = writer->temps++;
+        aot_line(writer, "double t%zu;", result);
+        aot_line(writer, "if (t%zu != 0)", condition);
+        aot_line(writer, "{");
+        writer->depth++;
+        size_t then = aot_node(writer, ast->left);
+        aot_line(writer, "t%zu = t%zu;", result, then);
+        writer->depth--;
+        aot_line(writer, "}");
+        aot_line(writer, "else");
+        aot_line(writer, "{");
+        writer->depth++;
+        size_t otherwise = aot_node(writer, ast->right);
+        aot_line(writer, "t%zu = t%zu;", result, otherwise);
+        writer->depth--;
+        aot_line(writer, "}");
+        return result;
+    }
+    case AST_SEQUENCEEXPR:
+        result = 0;
+        for (size_t i = 0; i < array_size(&ast->childs); i++)
+            result = aot_node(writer, array_at(&ast->childs, i));
+        return result;
+    default:
+    {
+        size_t count;
+        AST **args = eval_call_args(ast, &count);
+        size_t first = aot_node(writer, args[0]);
+        size_t second = count > 1 ? aot_node(writer, args[1]) : 0;
+        result = writer->temps++;
+        if (count > 1)
+            aot_line(writer, "double t%zu = %s(t%zu, t%zu);", result, ast->left->name, first, second);
+        else
+            aot_line(writer, "double t%zu = %s(t%zu);", result, ast->left->name, first);
+        return result;
+    }
+    }
+}
+static void aot_write_function(StrBuf *out, AST *expr, const EvalSignature *signature, const char *prefix,
+                               size_t index)
+{
+    strbuf_printf(out, "\n// %s%zu(", prefix, index);
+    for (size_t i = 0; i < signature->param_count; i++)
+        strbuf_printf(out, "%s%s", i ? ", " : "", signature->params[i]);
+    strbuf_printf(out, ")\ndouble %s%zu(", prefix, index);
+    for (size_t i = 0; i < signature->param_count; i++)
+        strbuf_printf(out, "%sdouble p%zu", i ? ", " : "", i);
+    strbuf_puts(out, signature->param_count ? ")\n{\n" : "void)\n{\n");
+    AotWriter writer = {out, signature, 0, 1};
+    size_t result = aot_node(&writer, expr);
+    aot_line(&writer, "return t%zu;", result);
+    strbuf_puts(out, "}\n");
+
+    strbuf_printf(out, "static double %s%zu_call(const double *args)\n{\n", prefix, index);
+    if (signature->param_count == 0)
+        strbuf_puts(out, "    (void)args;\n");
+    strbuf_printf(out, "    return %s%zu(", prefix, index);
+    for (size_t i = 0; i < signature->param_count; i++)
+        strbuf_printf(out, "%sargs[%zu]", i ? ", " : "", i);
+    strbuf_puts(out, ");\n}\n");
+    if (signature->param_count == 0)
+        return;
+    strbuf_printf(out, "static const char *const %s%zu_params[] = {", prefix, index);
+    for (size_t i = 0; i < signature->param_count; i++)
+    {
+        if (i)
+            strbuf_puts(out, ", ");
+        aot_put_c_string(out, signature->params[i]);
+    }
+    strbuf_puts(out, "};\n");
+}
+int aot_write_c(StrBuf *out, AST **exprs, size_t count, const AotOptions *options, StrBuf *error)
+{
+    const char *prefix = options && options->prefix ? options->prefix : AOT_DEFAULT_PREFIX;
+    EvalSignature *signatures = calloc(count ? count : 1, sizeof(EvalSignature));
+    for (size_t i = 0; i < count; i++)
+    {
+        const char *message = eval_check(exprs[i], &signatures[i]);
+        if (message == NULL)
+            continue;
+        AST *bad = signatures[i].bad;
+        if (bad && bad->token.start)
+            strbuf_printf(error, "expression %zu at %zu:%zu: %s", i, bad->token.row, bad->token.col, message);
+        else
+            strbuf_printf(error, "expression %zu: %s", i, message);
+        for (size_t j = 0; j <= i; j++)
+            eval_signature_free(&signatures[j]);
+        free(signatures);
+        return -1;
+    }
+
+    strbuf_puts(out, "// generated by pratt-parser, do not edit.\n"
+                     "#include <math.h>\n"
+                     "#include <stddef.h>\n"
+                     "#include <stdint.h>\n\n"
+                     "static int64_t pratt_int(double value)\n"
+                     "{\n"
+                     "    if (value != value)\n"
+                     "        return 0;\n"
+                     "    if (value >= 9223372036854775807.0)\n"
+                     "        return INT64_MAX;\n"
+                     "    if (value <= -9223372036854775808.0)\n"
+                     "        return INT64_MIN;\n"
+                     "    return (int64_t)value;\n"
+                     "}\n");
+    for (size_t i = 0; i < count; i++)
+        aot_write_function(out, exprs[i], &signatures[i], prefix, i);
+
+    strbuf_puts(out, "\nconst struct\n"
+                     "{\n"
+                     "    const char *name;\n"
+                     "    const char *const *params;\n"
+                     "    size_t param_count;\n"
+                     "    double (*call)(const double *args);\n"
+                     "} pratt_aot_table[] = {\n");
+    for (size_t i = 0; i < count; i++)
+    {
+        strbuf_printf(out, "    {\"%s%zu\", ", prefix, i);
+        if (signatures[i].param_count)
+            strbuf_printf(out, "%s%zu_params", prefix, i);
+        else
+            strbuf_puts(out, "NULL");
+        strbuf_printf(out, ", %zu, %s%zu_call},\n", signatures[i].param_count, prefix, i);
+        eval_signature_free(&signatures[i]);
+    }
+    if (count == 0)
+        strbuf_puts(out, "    {NULL, NULL, 0, NULL},\n");
+    strbuf_printf(out, "};\nconst size_t pratt_aot_count = %zu;\n", count);
+    free(signatures);
+    return 0;
+}
+
+static int aot_write_file(const char *path, const char *data, size_t length)
+{
+    FILE *file = fopen(path, "wb");
+    if (file == NULL)
+        return -1;
+    size_t written = fwrite(data, 1, length, file);
+    return fclose(file) == 0 && written == length ? 0 : -1;
+}
+// the compiler's stdout and stderr go to log so a failed build can be reported without printing anything.
+static int aot_run_compiler(const AotOptions *options, const char *c_path, const char *so_path, const char *log_path)
+{
+    const char *cc = options && options->cc ? options->cc : getenv("CC");
+    if (cc == NULL || cc[0] == '\0')
+        cc = "cc";
+    const char *optimize = options && options->optimize ? options->optimize : "-O2";
+    char *argv[] = {(char *)cc, (char *)optimize, "-shared", "-fPIC", "-o", (char *)so_path, (char *)c_path, "-lm",
+                    NULL};
+    pid_t pid = fork();
+    if (pid < 0)
+        return -1;
+    if (pid == 0)
+    {
+        int log = open(log_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        if (log >= 0)
+        {
+            dup2(log, STDOUT_FILENO);
+            dup2(log, STDERR_FILENO);
+        }
+        execvp(cc, argv);
+        _exit(127);
+    }
+    int status;
+    while (waitpid(pid, &status, 0) < 0)
+        if (errno != EINTR)
+            return -1;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+static void aot_append_log(StrBuf *error, const char *log_path)
+{
+    FILE *file = fopen(log_path, "rb");
+    if (file == NULL)
+        return;
+    char chunk[4096];
+    size_t got;
+    while ((got = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        strbuf_append(error, chunk, got);
+    fclose(file);
+}
+static char *aot_path(const char *dir, const char *name)
+{
+    StrBuf path = init_strbuf();
+    strbuf_printf(&path, "%s/%s", dir, name);
+    return strbuf_detach(&path);
+}
+static void aot_remove_files(const char *dir)
+{
+    static const char *const names[] = {"aot.c", "aot.so", "cc.log"};
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+    {
+        char *path = aot_path(dir, names[i]);
+        unlink(path);
+        free(path);
+    }
+}
+AotModule *aot_compile(AST **exprs, size_t count, const AotOptions *options, StrBuf *error)
+{
+    StrBuf source = init_strbuf();
+    if (aot_write_c(&source, exprs, count, options, error) != 0)
+    {
+        strbuf_free(&source);
+        return NULL;
+    }
+    AotModule *module = calloc(1, sizeof(AotModule));
+    if (options && options->dir)
+        module->dir = strdup(options->dir);
+    else
+    {
+        const char *tmp = getenv("TMPDIR");
+        module->dir = aot_path(tmp && tmp[0] ? tmp : "/tmp", "pratt-aot-XXXXXX");
+        module->owns_dir = mkdtemp(module->dir) != NULL;
+        if (!module->owns_dir)
+        {
+            strbuf_printf(error, "could not create a build directory: %s", strerror(errno));
+            strbuf_free(&source);
+            aot_module_free(module);
+            return NULL;
+        }
+    }
+    char *c_path = aot_path(module->dir, "aot.c");
+    char *so_path = aot_path(module->dir, "aot.so");
+    char *log_path = aot_path(module->dir, "cc.log");
+    if (aot_write_file(c_path, source.data, source.length) != 0)
+        strbuf_printf(error, "could not write %s: %s", c_path, strerror(errno));
+    else if (aot_run_compiler(options, c_path, so_path, log_path) != 0)
+    {
+        strbuf_puts(error, "the C compiler failed:\n");
+        aot_append_log(error, log_path);
+    }
+    else if ((module->handle = dlopen(so_path, RTLD_NOW | RTLD_LOCAL)) == NULL)
+        strbuf_printf(error, "could not load %s: %s", so_path, dlerror());
+    else
+    {
+        module->entries = dlsym(module->handle, "pratt_aot_table");
+        const size_t *entry_count = dlsym(module->handle, "pratt_aot_count");
+        if (module->entries && entry_count)
+            module->count = *entry_count;
+        else
+            strbuf_printf(error, "%s has no pratt_aot_table.", so_path);
+    }
+    int failed = module->entries == NULL;
+    free(c_path);
+    free(so_path);
+    free(log_path);
+    strbuf_free(&source);
+    if (failed)
+    {
+        aot_module_free(module);
+        return NULL;
+    }
+    return module;
+}
+const AotEntry *aot_lookup(const AotModule *module, const char *name)
+{
+    for (size_t i = 0; i < module->count; i++)
+        if (strcmp(module->entries[i].name, name) == 0)
+            return &module->entries[i];
+    return NULL;
+}
+// a directory passed in options is left alone so the generated source and object can be inspected.
+void aot_module_free(AotModule *module)
+{
+    if (module == NULL)
+        return;
+    if (module->handle)
+        dlclose(module->handle);
+    if (module->owns_dir)
+    {
+        aot_remove_files(module->dir);
+        rmdir(module->dir);
+    }
+    free(module->dir);
+    free(module);
+}
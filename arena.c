@@ -0,0 +1,77 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define ARENA_ALIGN 8
+
+static ArenaChunk *arena_new_chunk(size_t size)
+{
+    ArenaChunk *chunk = malloc(sizeof(ArenaChunk) + size);
+    assert(chunk != NULL && "cannot allocate memory");
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+    return chunk;
+}
+Arena *init_arena(size_t chunk_size)
+{
+    Arena *arena = calloc(1, sizeof(Arena));
+    arena->chunk_size = chunk_size ? chunk_size : 64 * 1024;
+    arena->head = arena_new_chunk(arena->chunk_size);
+    arena->allocated = 0;
+    arena->reserved = sizeof(ArenaChunk) + arena->chunk_size;
+    return arena;
+}
+void *arena_alloc(Arena *arena, size_t size)
+{
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    ArenaChunk *chunk = arena->head;
+    if (chunk->used + size > chunk->size)
+    {
+        size_t chunk_size = size > arena->chunk_size ? size : arena->chunk_size;
+        chunk = arena_new_chunk(chunk_size);
+        chunk->next = arena->head;
+        arena->head = chunk;
+        arena->reserved += sizeof(ArenaChunk) + chunk_size;
+    }
+    void *ptr = chunk->data + chunk->used;
+    chunk->used += size;
+    arena->allocated += size;
+    return ptr;
+}
+char *arena_strndup(Arena *arena, const char *str, size_t length)
+{
+    char *copy = arena_alloc(arena, length + 1);
+    memcpy(copy, str, length);
+    copy[length] = '\0';
+    return copy;
+}
+// keeps the most recent chunk so a warm arena does not go back to malloc.
+void arena_reset(Arena *arena)
+{
+    ArenaChunk *chunk = arena->head->next;
+    while (chunk)
+    {
+        ArenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    arena->head->next = NULL;
+    arena->head->used = 0;
+    arena->allocated = 0;
+    arena->reserved = sizeof(ArenaChunk) + arena->head->size;
+}
+void arena_free(Arena *arena)
+{
+    if (arena == NULL)
+        return;
+    ArenaChunk *chunk = arena->head;
+    while (chunk)
+    {
+        ArenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    free(arena);
+}
\ No newline at end of file
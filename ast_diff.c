@@ -0,0 +1,457 @@
+#define _POSIX_C_SOURCE 200809L
+#include "ast_diff.h"
+#include "hashcons.h"
+#include "helper.h"
+#include "json.h"
+#include "dtoa.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define AST_DIFF_SEED 0x6173745f64696666ULL
+#define AST_DIFF_WINDOW 16
+
+typedef struct
+{
+    ASTDiff *diff;
+    StrBuf from;
+    StrBuf to;
+} ASTDiffState;
+
+// how two child lists were paired: an identical subtree, or one worth descending into.
+enum
+{
+    AST_DIFF_UNPAIRED,
+    AST_DIFF_EXACT,
+    AST_DIFF_SIMILAR,
+};
+
+// a multimap from key to positions in the old child list; positions are stored plus one so 0 marks a free slot.
+typedef struct
+{
+    uint64_t *keys;
+    size_t *positions;
+    size_t mask;
+} ASTDiffTable;
+
+static void ast_diff_node(ASTDiffState *state, AST *before, AST *after);
+
+uint64_t ast_merkle_hash(AST *ast)
+{
+    if (ast == NULL)
+        return 0;
+    ast_merkle_hash(ast->value);
+    ast_merkle_hash(ast->left);
+    ast_merkle_hash(ast->right);
+    for (size_t i = 0; i < array_size(&ast->childs); i++)
+        ast_merkle_hash(array_at(&ast->childs, i));
+    ast->hash = hashcons_hash(ast);
+    return ast->hash;
+}
+static int ast_diff_same(AST *a, AST *b)
+{
+    if (a == NULL || b == NULL)
+        return a == b;
+    return a->hash == b->hash;
+}
+static int ast_diff_same_label(AST *a, AST *b)
+{
+    if ((a->name == NULL) != (b->name == NULL))
+        return 0;
+    if (a->name && strcmp(a->name, b->name) != 0)
+        return 0;
+    return a->type != AST_NUMBER || memcmp(&a->number, &b->number, sizeof(a->number)) == 0;
+}
+// type, name and first operand; an edited statement usually keeps these, so it is compared instead of replaced.
+static uint64_t ast_diff_shape(AST *ast)
+{
+    uint64_t type = (uint64_t)ast->type;
+    uint64_t hash = helper_hash64(&type, sizeof(type), AST_DIFF_SEED);
+    if (ast->name)
+        hash = helper_hash64(ast->name, strlen(ast->name), hash);
+    if (ast->left)
+        hash = helper_hash64(&ast->left->hash, sizeof(ast->left->hash), hash);
+    return hash;
+}
+static void ast_diff_edit(ASTDiffState *state, ASTEditKind kind, AST *before, AST *after)
+{
+    ASTEdit edit = {
+        .kind = kind,
+        .before = before,
+        .after = after,
+        .from = before ? strdup(state->from.data) : NULL,
+        .to = after ? strdup(state->to.data) : NULL,
+    };
+    array_push(&state->diff->edits, edit);
+}
+static void ast_diff_leave(StrBuf *path, size_t length)
+{
+    path->length = length;
+    path->data[length] = '\0';
+}
+static void ast_diff_pair(ASTDiffState *state, AST *before, AST *after)
+{
+    if (before && after)
+        ast_diff_node(state, before, after);
+    else if (before)
+        ast_diff_edit(state, AST_EDIT_DELETE, before, NULL);
+    else if (after)
+        ast_diff_edit(state, AST_EDIT_INSERT, NULL, after);
+}
+static void ast_diff_slot(ASTDiffState *state, AST *before, AST *after, const char *key)
+{
+    if (before == NULL && after == NULL)
+        return;
+    size_t from = state->from.length;
+    size_t to = state->to.length;
+    strbuf_printf(&state->from, "/%s", key);
+    strbuf_printf(&state->to, "/%s", key);
+    ast_diff_pair(state, before, after);
+    ast_diff_leave(&state->from, from);
+    ast_diff_leave(&state->to, to);
+}
+static ASTDiffTable init_ast_diff_table(size_t count)
+{
+    size_t capacity = 16;
+    while (capacity < count * 2)
+        capacity *= 2;
+    ASTDiffTable table = {
+        .keys = malloc(capacity * sizeof(uint64_t)),
+        .positions = calloc(capacity, sizeof(size_t)),
+        .mask = capacity - 1,
+    };
+    assert(table.keys != NULL && table.positions != NULL && "cannot allocate memory");
+    return table;
+}
+static void ast_diff_table_add(ASTDiffTable *table, uint64_t key, size_t position)
+{
+    size_t slot = (size_t)key & table->mask;
+    while (table->positions[slot])
+        slot = (slot + 1) & table->mask;
+    table->keys[slot] = key;
+    table->positions[slot] = position + 1;
+}
+// the untaken position under key nearest to near, so repeated statements pair with their own copy and not the first;
+// with unique set, only a key that has a single untaken position pairs at all, and none pairs farther than window.
+static size_t ast_diff_table_take(ASTDiffTable *table, uint64_t key, size_t near, size_t window, int unique,
+                                  unsigned char *taken)
+{
+    size_t best = 0, best_distance = SIZE_MAX, candidates = 0;
+    for (size_t slot = (size_t)key & table->mask; table->positions[slot]; slot = (slot + 1) & table->mask)
+    {
+        size_t position = table->positions[slot] - 1;
+        if (table->keys[slot] != key || taken[position])
+            continue;
+        size_t distance = position > near ? position - near : near - position;
+        candidates++;
+        if (distance < best_distance)
+        {
+            best = position + 1;
+            best_distance = distance;
+        }
+    }
+    if (best == 0 || best_distance > window || (unique && candidates != 1))
+        return 0;
+    taken[best - 1] = 1;
+    return best;
+}
+static void ast_diff_table_free(ASTDiffTable *table)
+{
+    free(table->keys);
+    free(table->positions);
+}
+// pairs every unpaired new child with an untaken old one under the same key, exact hashes or shapes. Without
+// stays only unique keys pair; with it a repeated key is looked for where the last child that stayed puts it, at
+// most window positions away.
+static void ast_diff_match(AST **before, size_t before_count, AST **after, size_t after_count, size_t *partner,
+                           unsigned char *kind, unsigned char *taken, const unsigned char *stays, size_t window,
+                           unsigned char match)
+{
+    ASTDiffTable table = init_ast_diff_table(before_count);
+    for (size_t i = 0; i < before_count; i++)
+    {
+        if (before[i] && !taken[i])
+            ast_diff_table_add(&table, match == AST_DIFF_EXACT ? before[i]->hash : ast_diff_shape(before[i]), i);
+    }
+    // old position minus new position of the last child that stayed; it wraps around after deletes.
+    size_t shift = 0;
+    for (size_t j = 0; j < after_count; j++)
+    {
+        if (kind[j] == AST_DIFF_EXACT && stays && stays[j])
+            shift = partner[j] - 1 - j;
+        if (after[j] == NULL || kind[j] != AST_DIFF_UNPAIRED)
+            continue;
+        uint64_t key = match == AST_DIFF_EXACT ? after[j]->hash : ast_diff_shape(after[j]);
+        size_t near = j + shift > SIZE_MAX / 2 ? 0 : j + shift;
+        if ((partner[j] = ast_diff_table_take(&table, key, near, window, stays == NULL, taken)))
+            kind[j] = match;
+    }
+    ast_diff_table_free(&table);
+}
+// marks the exact pairs that keep their relative order, the longest increasing run of old positions; the rest moved.
+static void ast_diff_stay(const size_t *partner, const unsigned char *kind, size_t count, unsigned char *stays)
+{
+    size_t *tails = malloc((count + 1) * sizeof(size_t));
+    size_t *previous = malloc((count + 1) * sizeof(size_t));
+    assert(tails != NULL && previous != NULL && "cannot allocate memory");
+    size_t length = 0;
+    for (size_t j = 0; j < count; j++)
+    {
+        if (kind[j] != AST_DIFF_EXACT)
+            continue;
+        size_t low = 0, high = length;
+        while (low < high)
+        {
+            size_t middle = (low + high) / 2;
+            if (partner[tails[middle]] < partner[j])
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        previous[j] = low ? tails[low - 1] : SIZE_MAX;
+        tails[low] = j;
+        if (low == length)
+            length++;
+    }
+    for (size_t j = length ? tails[length - 1] : SIZE_MAX; j != SIZE_MAX; j = previous[j])
+        stays[j] = 1;
+    free(tails);
+    free(previous);
+}
+static void ast_diff_children(ASTDiffState *state, AST *before, AST *after)
+{
+    AST **a = before->childs.items;
+    AST **b = after->childs.items;
+    size_t n = array_size(&before->childs);
+    size_t m = array_size(&after->childs);
+    size_t head = 0, tail = 0;
+    while (head < n && head < m && ast_diff_same(a[head], b[head]))
+        head++;
+    while (tail < n - head && tail < m - head && ast_diff_same(a[n - 1 - tail], b[m - 1 - tail]))
+        tail++;
+    size_t before_count = n - head - tail;
+    size_t after_count = m - head - tail;
+    if (before_count == 0 && after_count == 0)
+        return;
+    a += head;
+    b += head;
+
+    size_t *partner = calloc(after_count + 1, sizeof(size_t));
+    unsigned char *kind = calloc(after_count + 1, 1);
+    unsigned char *stays = calloc(after_count + 1, 1);
+    unsigned char *taken = calloc(before_count + 1, 1);
+    assert(partner != NULL && kind != NULL && stays != NULL && taken != NULL && "cannot allocate memory");
+    // unique subtrees first; those still in order anchor where the repeated ones and the edited ones are looked for,
+    // close to where they should be before anywhere, so a copy that moved does not pair with one that stayed.
+    ast_diff_match(a, before_count, b, after_count, partner, kind, taken, NULL, SIZE_MAX, AST_DIFF_EXACT);
+    ast_diff_stay(partner, kind, after_count, stays);
+    ast_diff_match(a, before_count, b, after_count, partner, kind, taken, stays, AST_DIFF_WINDOW, AST_DIFF_EXACT);
+    ast_diff_match(a, before_count, b, after_count, partner, kind, taken, stays, SIZE_MAX, AST_DIFF_EXACT);
+    memset(stays, 0, after_count);
+    ast_diff_stay(partner, kind, after_count, stays);
+    ast_diff_match(a, before_count, b, after_count, partner, kind, taken, stays, AST_DIFF_WINDOW, AST_DIFF_SIMILAR);
+    ast_diff_match(a, before_count, b, after_count, partner, kind, taken, stays, SIZE_MAX, AST_DIFF_SIMILAR);
+    // what is left pairs up in order when the types agree, so a rewritten statement is still diffed inside.
+    for (size_t i = 0, j = 0; i < before_count && j < after_count;)
+    {
+        if (a[i] == NULL || taken[i])
+            i++;
+        else if (b[j] == NULL || kind[j] != AST_DIFF_UNPAIRED)
+            j++;
+        else
+        {
+            if (a[i]->type == b[j]->type)
+            {
+                taken[i] = 1;
+                partner[j] = i + 1;
+                kind[j] = AST_DIFF_SIMILAR;
+            }
+            i++;
+            j++;
+        }
+    }
+
+    size_t from = state->from.length;
+    size_t to = state->to.length;
+    for (size_t j = 0; j < after_count; j++)
+    {
+        if (b[j] == NULL || (kind[j] == AST_DIFF_EXACT && stays[j]))
+            continue;
+        strbuf_printf(&state->to, "/children/%zu", head + j);
+        if (kind[j] == AST_DIFF_UNPAIRED)
+            ast_diff_edit(state, AST_EDIT_INSERT, NULL, b[j]);
+        else
+        {
+            strbuf_printf(&state->from, "/children/%zu", head + partner[j] - 1);
+            if (kind[j] == AST_DIFF_EXACT)
+                ast_diff_edit(state, AST_EDIT_MOVE, a[partner[j] - 1], b[j]);
+            else
+                ast_diff_node(state, a[partner[j] - 1], b[j]);
+            ast_diff_leave(&state->from, from);
+        }
+        ast_diff_leave(&state->to, to);
+    }
+    for (size_t i = 0; i < before_count; i++)
+    {
+        if (a[i] == NULL || taken[i])
+            continue;
+        strbuf_printf(&state->from, "/children/%zu", head + i);
+        ast_diff_edit(state, AST_EDIT_DELETE, a[i], NULL);
+        ast_diff_leave(&state->from, from);
+    }
+    free(partner);
+    free(kind);
+    free(stays);
+    free(taken);
+}
+static void ast_diff_node(ASTDiffState *state, AST *before, AST *after)
+{
+    state->diff->visited++;
+    if (before->hash == after->hash)
+        return;
+    if (before->type != after->type)
+    {
+        ast_diff_edit(state, AST_EDIT_DELETE, before, NULL);
+        ast_diff_edit(state, AST_EDIT_INSERT, NULL, after);
+        return;
+    }
+    if (!ast_diff_same_label(before, after))
+        ast_diff_edit(state, AST_EDIT_UPDATE, before, after);
+    ast_diff_slot(state, before->left, after->left, "left");
+    ast_diff_slot(state, before->right, after->right, "right");
+    ast_diff_slot(state, before->value, after->value, "value");
+    ast_diff_children(state, before, after);
+}
+static int ast_diff_is_leaf(AST *ast)
+{
+    return ast->left == NULL && ast->right == NULL && ast->value == NULL && array_size(&ast->childs) == 0;
+}
+// a subtree deleted in one place and inserted unchanged in another, under any parent, is a move; leaves are
+// left alone, an identifier dropped here and used there is not worth a move.
+static void ast_diff_moves(ASTDiff *diff)
+{
+    size_t count = diff->edits.count;
+    ASTEdit *edits = diff->edits.items;
+    ASTDiffTable table = init_ast_diff_table(count);
+    unsigned char *taken = calloc(count + 1, 1);
+    assert(taken != NULL && "cannot allocate memory");
+    for (size_t i = 0; i < count; i++)
+    {
+        if (edits[i].kind == AST_EDIT_DELETE && !ast_diff_is_leaf(edits[i].before))
+            ast_diff_table_add(&table, edits[i].before->hash, i);
+    }
+    // the deletes turn into moves in place first; compacting in the same pass would move a delete that comes
+    // before its insert out of its slot.
+    unsigned char *folded = calloc(count + 1, 1);
+    assert(folded != NULL && "cannot allocate memory");
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t deleted;
+        if (edits[i].kind == AST_EDIT_INSERT &&
+            (deleted = ast_diff_table_take(&table, edits[i].after->hash, i, SIZE_MAX, 0, taken)))
+        {
+            ASTEdit *move = &edits[deleted - 1];
+            move->kind = AST_EDIT_MOVE;
+            move->after = edits[i].after;
+            move->to = edits[i].to;
+            folded[i] = 1;
+        }
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!folded[i])
+            edits[kept++] = edits[i];
+    }
+    diff->edits.count = kept;
+    ast_diff_table_free(&table);
+    free(folded);
+    free(taken);
+}
+ASTDiff *ast_diff(AST *before, AST *after)
+{
+    ASTDiff *diff = calloc(1, sizeof(ASTDiff));
+    assert(diff != NULL && "cannot allocate memory");
+    init_array(&diff->edits);
+    ast_merkle_hash(before);
+    ast_merkle_hash(after);
+    ASTDiffState state = {
+        .diff = diff,
+        .from = init_strbuf(),
+        .to = init_strbuf(),
+    };
+    strbuf_reserve(&state.from, 64);
+    strbuf_reserve(&state.to, 64);
+    ast_diff_leave(&state.from, 0);
+    ast_diff_leave(&state.to, 0);
+    ast_diff_pair(&state, before, after);
+    ast_diff_moves(diff);
+    strbuf_free(&state.from);
+    strbuf_free(&state.to);
+    return diff;
+}
+static void ast_diff_label(StrBuf *out, AST *ast)
+{
+    strbuf_printf(out, "{\"type\": \"AST_%s\"", ast_type_to_str(ast->type));
+    if (ast->name)
+    {
+        strbuf_puts(out, ",\"name\": ");
+        json_put_string(out, ast->name, strlen(ast->name));
+    }
+    if (ast->type == AST_NUMBER)
+    {
+        strbuf_puts(out, ",\"number\": ");
+        strbuf_reserve(out, DTOA_BUFFER_SIZE);
+        out->length += dtoa_shortest(ast->number, out->data + out->length);
+    }
+    strbuf_putc(out, '}');
+}
+void ast_diff_write_json(StrBuf *out, ASTDiff *diff)
+{
+    static const char *const ops[] = {"insert", "delete", "update", "move"};
+    for (size_t i = 0; i < diff->edits.count; i++)
+    {
+        ASTEdit *edit = &diff->edits.items[i];
+        strbuf_printf(out, "{\"op\": \"%s\"", ops[edit->kind]);
+        if (edit->from)
+        {
+            strbuf_puts(out, ",\"from\": ");
+            json_put_string(out, edit->from, strlen(edit->from));
+        }
+        if (edit->to)
+        {
+            strbuf_puts(out, ",\"to\": ");
+            json_put_string(out, edit->to, strlen(edit->to));
+        }
+        if (edit->kind == AST_EDIT_INSERT)
+        {
+            strbuf_puts(out, ",\"ast\": ");
+            ast_write_json(out, edit->after, NULL);
+        }
+        else if (edit->kind == AST_EDIT_UPDATE)
+        {
+            strbuf_puts(out, ",\"before\": ");
+            ast_diff_label(out, edit->before);
+            strbuf_puts(out, ",\"after\": ");
+            ast_diff_label(out, edit->after);
+        }
+        else
+        {
+            strbuf_puts(out, ",\"node\": ");
+            ast_diff_label(out, edit->before);
+        }
+        strbuf_puts(out, "}\n");
+    }
+}
+void ast_diff_free(ASTDiff *diff)
+{
+    if (diff == NULL)
+        return;
+    for (size_t i = 0; i < diff->edits.count; i++)
+    {
+        free(diff->edits.items[i].from);
+        free(diff->edits.items[i].to);
+    }
+    free(diff->edits.items);
+    free(diff);
+}
@@ -0,0 +1,227 @@
+#include "ast_index.h"
+#include "helper.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define AST_INDEX_SEED 0x696e6465785f6e6dULL
+
+ASTIndex *init_ast_index(void)
+{
+    ASTIndex *index = calloc(1, sizeof(ASTIndex));
+    assert(index != NULL && "cannot allocate memory");
+    for (size_t i = 0; i < AST_TYPE_COUNT; i++)
+        init_array(&index->by_type[i]);
+    return index;
+}
+static size_t ast_index_name_slot(ASTIndex *index, const char *name, size_t length, uint64_t hash)
+{
+    size_t mask = index->name_capacity - 1;
+    size_t slot = (size_t)hash & mask;
+    while (index->name_slots[slot])
+    {
+        const char *other = index->names[index->name_slots[slot] - 1];
+        if (strncmp(other, name, length) == 0 && other[length] == '\0')
+            break;
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+// returns the 1-based id of name, adding it when create is set; 0 means it was never interned.
+static uint32_t ast_index_intern(ASTIndex *index, const char *name, int create)
+{
+    size_t length = strlen(name);
+    uint64_t hash = helper_hash64(name, length, AST_INDEX_SEED);
+    if (index->name_capacity == 0)
+    {
+        if (!create)
+            return 0;
+        index->name_capacity = 64;
+        index->name_slots = calloc(index->name_capacity, sizeof(uint32_t));
+    }
+    size_t slot = ast_index_name_slot(index, name, length, hash);
+    if (index->name_slots[slot] || !create)
+        return index->name_slots[slot];
+
+    if ((index->name_count + 1) * 2 > index->name_capacity)
+    {
+        uint32_t *old = index->name_slots;
+        size_t old_capacity = index->name_capacity;
+        index->name_capacity *= 2;
+        index->name_slots = calloc(index->name_capacity, sizeof(uint32_t));
+        for (size_t i = 0; i < old_capacity; i++)
+        {
+            if (old[i] == 0)
+                continue;
+            const char *other = index->names[old[i] - 1];
+            uint64_t other_hash = helper_hash64(other, strlen(other), AST_INDEX_SEED);
+            index->name_slots[ast_index_name_slot(index, other, strlen(other), other_hash)] = old[i];
+        }
+        free(old);
+        slot = ast_index_name_slot(index, name, length, hash);
+    }
+    if ((index->name_count & (index->name_count - 1)) == 0)
+        index->names = realloc(index->names, (index->name_count ? index->name_count * 2 : 1) * sizeof(char *));
+    char *copy = malloc(length + 1);
+    memcpy(copy, name, length + 1);
+    index->names[index->name_count++] = copy;
+    index->name_slots[slot] = (uint32_t)index->name_count;
+    return (uint32_t)index->name_count;
+}
+static size_t ast_index_named_slot(ASTIndex *index, uint64_t key)
+{
+    size_t mask = index->named_capacity - 1;
+    size_t slot = (size_t)(key * 0x9E3779B97F4A7C15ULL >> 20) & mask;
+    while (index->named[slot].key && index->named[slot].key != key)
+        slot = (slot + 1) & mask;
+    return slot;
+}
+static ASTIndexPostings *ast_index_postings(ASTIndex *index, uint64_t key, int create)
+{
+    if (index->named_capacity == 0)
+    {
+        if (!create)
+            return NULL;
+        index->named_capacity = 64;
+        index->named = calloc(index->named_capacity, sizeof(ASTIndexPostings));
+    }
+    size_t slot = ast_index_named_slot(index, key);
+    if (index->named[slot].key || !create)
+        return index->named[slot].key ? &index->named[slot] : NULL;
+
+    if ((index->named_count + 1) * 2 > index->named_capacity)
+    {
+        ASTIndexPostings *old = index->named;
+        size_t old_capacity = index->named_capacity;
+        index->named_capacity *= 2;
+        index->named = calloc(index->named_capacity, sizeof(ASTIndexPostings));
+        for (size_t i = 0; i < old_capacity; i++)
+            if (old[i].key)
+                index->named[ast_index_named_slot(index, old[i].key)] = old[i];
+        free(old);
+        slot = ast_index_named_slot(index, key);
+    }
+    index->named_count++;
+    index->named[slot].key = key;
+    init_array(&index->named[slot].nodes);
+    return &index->named[slot];
+}
+// most names occur a handful of times, so postings start far smaller than array_push's 256 slots.
+static void ast_index_push(ASTIndexPostings *postings, AST *ast)
+{
+    if (postings->nodes.count >= postings->nodes.capacity)
+    {
+        postings->nodes.capacity = postings->nodes.capacity ? postings->nodes.capacity * 2 : 4;
+        postings->nodes.items = realloc(postings->nodes.items, postings->nodes.capacity * sizeof(AST *));
+        assert(postings->nodes.items != NULL && "cannot allocate memory");
+    }
+    postings->nodes.items[postings->nodes.count++] = ast;
+}
+static uint64_t ast_index_key(AST_Type type, uint32_t name)
+{
+    return (uint64_t)type << 32 | name;
+}
+// shared nodes only exist under hash-consing; they are listed once, at their first occurrence.
+static int ast_index_seen(ASTIndex *index, AST *ast)
+{
+    if ((index->seen_count + 1) * 2 > index->seen_capacity)
+    {
+        AST **old = index->seen;
+        size_t old_capacity = index->seen_capacity;
+        index->seen_capacity = old_capacity ? old_capacity * 2 : 64;
+        index->seen = calloc(index->seen_capacity, sizeof(AST *));
+        for (size_t i = 0; i < old_capacity; i++)
+        {
+            if (old[i] == NULL)
+                continue;
+            size_t slot = (size_t)(((uintptr_t)old[i] >> 4) * 0x9E3779B97F4A7C15ULL) & (index->seen_capacity - 1);
+            while (index->seen[slot])
+                slot = (slot + 1) & (index->seen_capacity - 1);
+            index->seen[slot] = old[i];
+        }
+        free(old);
+    }
+    size_t slot = (size_t)(((uintptr_t)ast >> 4) * 0x9E3779B97F4A7C15ULL) & (index->seen_capacity - 1);
+    while (index->seen[slot] && index->seen[slot] != ast)
+        slot = (slot + 1) & (index->seen_capacity - 1);
+    if (index->seen[slot])
+        return 1;
+    index->seen[slot] = ast;
+    index->seen_count++;
+    return 0;
+}
+static const char *ast_index_name_of(AST *ast)
+{
+    if (ast->type == AST_FUNCTION_CALL)
+        return ast->left && ast->left->type == AST_ID ? ast->left->name : NULL;
+    return ast->name;
+}
+void ast_index_add(ASTIndex *index, AST *ast)
+{
+    if (ast == NULL || (ast->refcount > 1 && ast_index_seen(index, ast)))
+        return;
+    array_push(&index->by_type[ast->type], ast);
+    const char *name = ast_index_name_of(ast);
+    if (name)
+    {
+        uint64_t key = ast_index_key(ast->type, ast_index_intern(index, name, 1));
+        ast_index_push(ast_index_postings(index, key, 1), ast);
+    }
+    ast_index_add(index, ast->value);
+    ast_index_add(index, ast->left);
+    ast_index_add(index, ast->right);
+    for (size_t i = 0; i < array_size(&ast->childs); i++)
+        ast_index_add(index, array_at(&ast->childs, i));
+}
+AST **ast_index_of_type(ASTIndex *index, AST_Type type, size_t *count)
+{
+    *count = array_size(&index->by_type[type]);
+    return index->by_type[type].items;
+}
+AST **ast_index_named(ASTIndex *index, AST_Type type, const char *name, size_t *count)
+{
+    *count = 0;
+    uint32_t id = ast_index_intern(index, name, 0);
+    if (id == 0)
+        return NULL;
+    ASTIndexPostings *postings = ast_index_postings(index, ast_index_key(type, id), 0);
+    if (postings == NULL)
+        return NULL;
+    *count = array_size(&postings->nodes);
+    return postings->nodes.items;
+}
+AST **ast_index_calls(ASTIndex *index, const char *callee, size_t *count)
+{
+    return ast_index_named(index, AST_FUNCTION_CALL, callee, count);
+}
+void ast_index_clear(ASTIndex *index)
+{
+    for (size_t i = 0; i < AST_TYPE_COUNT; i++)
+        array_size(&index->by_type[i]) = 0;
+    for (size_t i = 0; i < index->named_capacity; i++)
+        array_free(&index->named[i].nodes);
+    if (index->named)
+        memset(index->named, 0, index->named_capacity * sizeof(ASTIndexPostings));
+    index->named_count = 0;
+    for (size_t i = 0; i < index->name_count; i++)
+        free(index->names[i]);
+    index->name_count = 0;
+    if (index->name_slots)
+        memset(index->name_slots, 0, index->name_capacity * sizeof(uint32_t));
+    if (index->seen)
+        memset(index->seen, 0, index->seen_capacity * sizeof(AST *));
+    index->seen_count = 0;
+}
+void ast_index_free(ASTIndex *index)
+{
+    if (index == NULL)
+        return;
+    ast_index_clear(index);
+    for (size_t i = 0; i < AST_TYPE_COUNT; i++)
+        array_free(&index->by_type[i]);
+    free(index->named);
+    free(index->names);
+    free(index->name_slots);
+    free(index->seen);
+    free(index);
+}
@@ -0,0 +1,32 @@
+#include "ast_snapshot.h"
+#include <stdlib.h>
+
+const ASTSnapshot *ast_freeze(AST *root, Arena *arena, ASTIndex *index)
+{
+    ASTSnapshot *snapshot = calloc(1, sizeof(ASTSnapshot));
+    snapshot->root = root;
+    snapshot->arena = arena;
+    snapshot->index = index;
+    atomic_init(&snapshot->refs, 1);
+    return snapshot;
+}
+const ASTSnapshot *ast_snapshot_retain(const ASTSnapshot *snapshot)
+{
+    ASTSnapshot *owned = (ASTSnapshot *)snapshot;
+    if (owned)
+        atomic_fetch_add_explicit(&owned->refs, 1, memory_order_relaxed);
+    return snapshot;
+}
+// the last release drops an arena-built tree in one go; a heap-built one still needs the recursive ast_free.
+void ast_snapshot_release(const ASTSnapshot *snapshot)
+{
+    ASTSnapshot *owned = (ASTSnapshot *)snapshot;
+    if (owned == NULL || atomic_fetch_sub_explicit(&owned->refs, 1, memory_order_acq_rel) != 1)
+        return;
+    ast_index_free(owned->index);
+    if (owned->arena)
+        arena_free(owned->arena);
+    else
+        ast_free((AST *)owned->root);
+    free(owned);
+}
@@ -0,0 +1,95 @@
+#define _POSIX_C_SOURCE 199309L
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lexer.h"
+#include "parser.h"
+#include "AST.h"
+#include "eval.h"
+#include "aot.h"
+#include "strbuf.h"
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+int main(int argc, char *argv[])
+{
+    size_t rules = argc > 1 ? (size_t)atol(argv[1]) : 64;
+    size_t rows = argc > 2 ? (size_t)atol(argv[2]) : 20000;
+    StrBuf source = init_strbuf();
+    for (size_t i = 0; i < rules; i++)
+        strbuf_printf(&source,
+                      "a * %zu + b / (c + 1) > d ? sqrt(a * a + b * b) - (e %% %zu) : fmax(c, d) * 0.5 + (a < b && "
+                      "c != d) - ((e & 7) | %zu);\n",
+                      i + 1, i % 7 + 2, i % 5);
+    // integral literals past 2^64 have to reach the compiler as floating ones.
+    strbuf_printf(&source, "100000000000000000000 / 10000000000000000000 + a * b - c + d * e;\n");
+
+    Lexer *lexer = init_lexer(source.data, "bench");
+    Parser *parser = init_parser(lexer);
+    AST *ast = parser_parse(parser);
+    if (parser->had_error)
+    {
+        fprintf(stderr, "[ERROR] benchmark input failed to parse.\n");
+        return 1;
+    }
+    size_t count = array_size(&ast->childs);
+    AST **exprs = ast->childs.items;
+    EvalSignature *signatures = calloc(count, sizeof(EvalSignature));
+    for (size_t i = 0; i < count; i++)
+        eval_check(exprs[i], &signatures[i]);
+
+    double start = bench_now();
+    StrBuf error = init_strbuf();
+    AotModule *module = aot_compile(exprs, count, NULL, &error);
+    double compile = bench_now() - start;
+    if (module == NULL)
+    {
+        fprintf(stderr, "[ERROR] %s\n", error.data);
+        return 1;
+    }
+
+    // every rule takes a, b, c, d, e in that order, so one row of inputs serves them all.
+    double *inputs = malloc(rows * 5 * sizeof(double));
+    srand(42);
+    for (size_t i = 0; i < rows * 5; i++)
+        inputs[i] = (double)(rand() % 2000) / 10.0 - 50.0;
+
+    double walk_sum = 0, aot_sum = 0;
+    start = bench_now();
+    for (size_t row = 0; row < rows; row++)
+        for (size_t i = 0; i < count; i++)
+            walk_sum += eval_ast(exprs[i], &signatures[i], &inputs[row * 5]);
+    double walk = bench_now() - start;
+    start = bench_now();
+    for (size_t row = 0; row < rows; row++)
+        for (size_t i = 0; i < count; i++)
+            aot_sum += module->entries[i].call(&inputs[row * 5]);
+    double compiled = bench_now() - start;
+    if (walk_sum != aot_sum)
+    {
+        fprintf(stderr, "[ERROR] tree walk sums to %.17g, compiled code to %.17g.\n", walk_sum, aot_sum);
+        return 1;
+    }
+    double evaluations = (double)rows * (double)count;
+    printf("%zu rules, cc %.1f ms\n", count, compile * 1e3);
+    printf("tree walk %.1f ns/eval, compiled %.1f ns/eval (%.1fx)\n", walk / evaluations * 1e9,
+           compiled / evaluations * 1e9, walk / compiled);
+
+    aot_module_free(module);
+    for (size_t i = 0; i < count; i++)
+        eval_signature_free(&signatures[i]);
+    free(signatures);
+    free(inputs);
+    strbuf_free(&error);
+    ast_free(ast);
+    parser_free(parser);
+    lexer_free(lexer);
+    strbuf_free(&source);
+    return 0;
+}
@@ -0,0 +1,61 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lexer.h"
+
+#if defined(LEXER_SCALAR) || !defined(__SSE2__)
+#define COMMENTS_NAME "scalar"
+#else
+#define COMMENTS_NAME "sse2"
+#endif
+
+// a license header followed by annotated statements, the shape of our generated sources.
+static const char *header = "/*\n * Copyright (c) the authors. Licensed under the terms of the licence file.\n"
+                            " * Permission is granted to use, copy, modify and distribute this software.\n */\n";
+static const char *line = "total = price * count; // computed from the order lines, see the pricing notes\n";
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+int main(int argc, char *argv[])
+{
+    size_t units = argc > 1 ? (size_t)atol(argv[1]) : 20000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 20;
+    size_t header_len = strlen(header);
+    size_t line_len = strlen(line);
+    size_t unit_len = header_len + 4 * line_len;
+    char *source = malloc(units * unit_len + 1);
+    char *p = source;
+    for (size_t i = 0; i < units; i++)
+    {
+        memcpy(p, header, header_len);
+        p += header_len;
+        for (int j = 0; j < 4; j++, p += line_len)
+            memcpy(p, line, line_len);
+    }
+    *p = '\0';
+
+    double best = 0;
+    size_t tokens = 0;
+    for (int round = 0; round < rounds; round++)
+    {
+        double start = bench_now();
+        Lexer *lexer = init_lexer(source, "bench");
+        tokens = 0;
+        while (lexer_next_token(lexer).type != TOKEN_EOF)
+            tokens++;
+        double elapsed = bench_now() - start;
+        lexer_free(lexer);
+        if (round == 0 || elapsed < best)
+            best = elapsed;
+    }
+    printf("%s comments: %zu bytes, %zu tokens in %.3f ms (%.1f MB/s)\n", COMMENTS_NAME, units * unit_len, tokens,
+           best * 1e3, (double)(units * unit_len) / best / 1e6);
+    free(source);
+    return 0;
+}
@@ -0,0 +1,133 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lexer.h"
+#include "parser.h"
+#include "AST.h"
+#include "ast_diff.h"
+#include "strbuf.h"
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+static AST *bench_parse(StrBuf *source, Lexer **lexer, Parser **parser)
+{
+    *lexer = init_lexer(source->data, "bench");
+    *parser = init_parser(*lexer);
+    AST *ast = parser_parse(*parser);
+    if ((*parser)->had_error)
+    {
+        fprintf(stderr, "[ERROR] benchmark input failed to parse.\n");
+        exit(1);
+    }
+    return ast;
+}
+// the old way: both trees as JSON, then a byte comparison that stands in for the text diff.
+static size_t bench_json_compare(AST *before, AST *after)
+{
+    StrBuf a = init_strbuf();
+    StrBuf b = init_strbuf();
+    ast_write_json(&a, before, NULL);
+    ast_write_json(&b, after, NULL);
+    size_t same = 0;
+    while (same < a.length && same < b.length && a.data[same] == b.data[same])
+        same++;
+    strbuf_free(&a);
+    strbuf_free(&b);
+    return same;
+}
+// two subtrees swapped across parents are two moves, whichever of their deletes and inserts comes first.
+static void bench_check_swap(void)
+{
+    StrBuf before_source = init_strbuf();
+    StrBuf after_source = init_strbuf();
+    strbuf_puts(&before_source, "{ p; a+b; } { q; f(x); }\n");
+    strbuf_puts(&after_source, "{ p; f(x); } { q; a+b; }\n");
+    Lexer *before_lexer, *after_lexer;
+    Parser *before_parser, *after_parser;
+    AST *before = bench_parse(&before_source, &before_lexer, &before_parser);
+    AST *after = bench_parse(&after_source, &after_lexer, &after_parser);
+    ASTDiff *diff = ast_diff(before, after);
+    int moved = diff->edits.count == 2;
+    for (size_t i = 0; moved && i < diff->edits.count; i++)
+    {
+        ASTEdit *edit = &diff->edits.items[i];
+        moved = edit->kind == AST_EDIT_MOVE && strcmp(edit->from, edit->to) != 0 &&
+                (strcmp(edit->to, "/children/0/children/1") == 0 || strcmp(edit->to, "/children/1/children/1") == 0);
+    }
+    if (!moved)
+    {
+        StrBuf out = init_strbuf();
+        ast_diff_write_json(&out, diff);
+        fprintf(stderr, "[ERROR] a swap across parents should be two moves, got:\n%s", out.data ? out.data : "");
+        exit(1);
+    }
+    ast_diff_free(diff);
+    ast_free(before);
+    ast_free(after);
+    parser_free(before_parser);
+    parser_free(after_parser);
+    lexer_free(before_lexer);
+    lexer_free(after_lexer);
+    strbuf_free(&before_source);
+    strbuf_free(&after_source);
+}
+int main(int argc, char *argv[])
+{
+    bench_check_swap();
+    size_t lines = argc > 1 ? (size_t)atol(argv[1]) : 200000;
+    size_t changes = argc > 2 ? (size_t)atol(argv[2]) : 10;
+    StrBuf before_source = init_strbuf();
+    StrBuf after_source = init_strbuf();
+    for (size_t i = 0; i < lines; i++)
+    {
+        strbuf_printf(&before_source, "a%zu = b + c * g%zu(x) - (y ? %zu : z);\n", i, i % 1000, i % 7);
+        // every lines / changes-th statement changes one operator; one more is inserted at the end.
+        if (changes && i % (lines / changes) == lines / changes / 2)
+            strbuf_printf(&after_source, "a%zu = b - c * g%zu(x) - (y ? %zu : z);\n", i, i % 1000, i % 7);
+        else
+            strbuf_printf(&after_source, "a%zu = b + c * g%zu(x) - (y ? %zu : z);\n", i, i % 1000, i % 7);
+    }
+    strbuf_puts(&after_source, "done = 1;\n");
+
+    Lexer *before_lexer, *after_lexer;
+    Parser *before_parser, *after_parser;
+    double start = bench_now();
+    AST *before = bench_parse(&before_source, &before_lexer, &before_parser);
+    AST *after = bench_parse(&after_source, &after_lexer, &after_parser);
+    double parse = bench_now() - start;
+
+    start = bench_now();
+    bench_json_compare(before, after);
+    double json = bench_now() - start;
+
+    start = bench_now();
+    ast_merkle_hash(before);
+    ast_merkle_hash(after);
+    double hash = bench_now() - start;
+
+    start = bench_now();
+    ASTDiff *diff = ast_diff(before, after);
+    double total = bench_now() - start;
+
+    printf("%zu statements, %zu changed: parse both %.1f ms\n", lines, changes, parse * 1e3);
+    printf("json dump and compare %.1f ms, merkle hashes %.1f ms, diff with hashing %.1f ms\n", json * 1e3,
+           hash * 1e3, total * 1e3);
+    printf("%zu edits, %zu node pairs visited\n", diff->edits.count, diff->visited);
+
+    ast_diff_free(diff);
+    ast_free(before);
+    ast_free(after);
+    parser_free(before_parser);
+    parser_free(after_parser);
+    lexer_free(before_lexer);
+    lexer_free(after_lexer);
+    strbuf_free(&before_source);
+    strbuf_free(&after_source);
+    return 0;
+}
@@ -0,0 +1,57 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lexer.h"
+#include "parser.h"
+#include "AST.h"
+
+#ifdef PARSER_TABLE_DISPATCH
+#define DISPATCH_NAME "table"
+#else
+#define DISPATCH_NAME "switch"
+#endif
+
+static const char *line = "a+b*c-d/e%f<<g>>h==i!=j&&k||l<m>n<=o>=p&q|r?s:-t*!u+~v,w=x=y;\n";
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+int main(int argc, char *argv[])
+{
+    size_t lines = argc > 1 ? (size_t)atol(argv[1]) : 20000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 20;
+    size_t line_len = strlen(line);
+    char *source = malloc(lines * line_len + 1);
+    for (size_t i = 0; i < lines; i++)
+        memcpy(source + i * line_len, line, line_len);
+    source[lines * line_len] = '\0';
+
+    double best = 0;
+    for (int round = 0; round < rounds; round++)
+    {
+        double start = bench_now();
+        Lexer *lexer = init_lexer(source, "bench");
+        Parser *parser = init_parser(lexer);
+        AST *ast = parser_parse(parser);
+        double elapsed = bench_now() - start;
+        if (parser->had_error)
+        {
+            fprintf(stderr, "[ERROR] benchmark input failed to parse.\n");
+            return 1;
+        }
+        ast_free(ast);
+        parser_free(parser);
+        lexer_free(lexer);
+        if (round == 0 || elapsed < best)
+            best = elapsed;
+    }
+    printf("%s dispatch: %zu bytes in %.3f ms (%.1f MB/s)\n", DISPATCH_NAME, lines * line_len,
+           best * 1e3, (double)(lines * line_len) / best / 1e6);
+    free(source);
+    return 0;
+}
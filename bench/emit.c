@@ -0,0 +1,70 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lexer.h"
+#include "parser.h"
+#include "AST.h"
+#include "emit.h"
+#include "strbuf.h"
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+static void bench_emit(const char *label, StrBuf *source, size_t children, int rounds)
+{
+    Lexer *lexer = init_lexer(source->data, "bench");
+    Parser *parser = init_parser(lexer);
+    AST *ast = parser_parse(parser);
+    if (parser->had_error)
+    {
+        fprintf(stderr, "[ERROR] benchmark input failed to parse.\n");
+        exit(1);
+    }
+    FILE *sink = fopen("/dev/null", "wb");
+    int jobs[] = {1, 2, 4, 8};
+    double serial = 0;
+    for (size_t j = 0; j < sizeof(jobs) / sizeof(jobs[0]); j++)
+    {
+        double best = 0;
+        for (int round = 0; round < rounds; round++)
+        {
+            double start = bench_now();
+            ast_emit_json(sink, ast, NULL, jobs[j]);
+            double elapsed = bench_now() - start;
+            if (round == 0 || elapsed < best)
+                best = elapsed;
+        }
+        if (j == 0)
+            serial = best;
+        printf("emit %s, %d jobs: %zu children in %.3f ms (%.2fx)\n", label, jobs[j], children, best * 1e3,
+               serial / best);
+    }
+    fclose(sink);
+    ast_free(ast);
+    parser_free(parser);
+    lexer_free(lexer);
+}
+int main(int argc, char *argv[])
+{
+    size_t lines = argc > 1 ? (size_t)atol(argv[1]) : 200000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 5;
+    StrBuf source = init_strbuf();
+    for (size_t i = 0; i < lines; i++)
+        strbuf_printf(&source, "a%zu = (b + c * %zu.5) - \"s%zu\" / f(x, y, z);\n", i, i, i);
+    bench_emit("root", &source, lines, rounds);
+
+    // the same statements in one block below the root, which only has two children.
+    strbuf_reset(&source);
+    strbuf_puts(&source, "init = 1;\n{\n");
+    for (size_t i = 0; i < lines; i++)
+        strbuf_printf(&source, "a%zu = (b + c * %zu.5) - \"s%zu\" / f(x, y, z);\n", i, i, i);
+    strbuf_puts(&source, "}\n");
+    bench_emit("block", &source, lines, rounds);
+    strbuf_free(&source);
+    return 0;
+}
@@ -0,0 +1,67 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "json.h"
+#include "strbuf.h"
+
+#if defined(JSON_SCALAR)
+#define ESCAPE_NAME "scalar"
+#elif defined(__AVX2__)
+#define ESCAPE_NAME "avx2"
+#else
+#define ESCAPE_NAME "sse2"
+#endif
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+int main(int argc, char *argv[])
+{
+    size_t strings = argc > 1 ? (size_t)atol(argv[1]) : 100000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 10;
+    // mostly clean literals of mixed length with an occasional tab or backslash, like real string-heavy sources.
+    char **items = malloc(strings * sizeof(char *));
+    size_t *lengths = malloc(strings * sizeof(size_t));
+    size_t total = 0;
+    unsigned seed = 12345;
+    for (size_t i = 0; i < strings; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        size_t length = 8 + (seed >> 16) % 120;
+        items[i] = malloc(length);
+        for (size_t j = 0; j < length; j++)
+        {
+            seed = seed * 1103515245 + 12345;
+            unsigned r = (seed >> 16) % 200;
+            items[i][j] = r == 0 ? '\t' : r == 1 ? '\\' : (char)('a' + r % 26);
+        }
+        lengths[i] = length;
+        total += length;
+    }
+
+    StrBuf out = init_strbuf();
+    double best = 0;
+    for (int round = 0; round < rounds; round++)
+    {
+        strbuf_reset(&out);
+        double start = bench_now();
+        for (size_t i = 0; i < strings; i++)
+            json_put_string(&out, items[i], lengths[i]);
+        double elapsed = bench_now() - start;
+        if (round == 0 || elapsed < best)
+            best = elapsed;
+    }
+    printf("%s escape: %zu bytes in %.3f ms (%.1f MB/s)\n", ESCAPE_NAME, total, best * 1e3,
+           (double)total / best / 1e6);
+    for (size_t i = 0; i < strings; i++)
+        free(items[i]);
+    free(items);
+    free(lengths);
+    strbuf_free(&out);
+    return 0;
+}
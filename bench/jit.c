@@ -0,0 +1,90 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lexer.h"
+#include "parser.h"
+#include "AST.h"
+#include "eval.h"
+#include "jit.h"
+#include "strbuf.h"
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+int main(int argc, char *argv[])
+{
+    size_t rules = argc > 1 ? (size_t)atol(argv[1]) : 64;
+    size_t rows = argc > 2 ? (size_t)atol(argv[2]) : 20000;
+    StrBuf source = init_strbuf();
+    for (size_t i = 0; i < rules; i++)
+        strbuf_printf(&source,
+                      "a * %zu + b / (c + 1) > d ? (a * a + b * b) - (e - %zu) : (c >= d) * 0.5 + (a < b && "
+                      "c != d) - -e;\n",
+                      i + 1, i % 7 + 2);
+
+    Lexer *lexer = init_lexer(source.data, "bench");
+    Parser *parser = init_parser(lexer);
+    AST *ast = parser_parse(parser);
+    if (parser->had_error)
+    {
+        fprintf(stderr, "[ERROR] benchmark input failed to parse.\n");
+        return 1;
+    }
+    size_t count = array_size(&ast->childs);
+    AST **exprs = ast->childs.items;
+    StrBuf error = init_strbuf();
+    JitFunction **functions = calloc(count, sizeof(JitFunction *));
+    double start = bench_now();
+    for (size_t i = 0; i < count; i++)
+        functions[i] = jit_compile(exprs[i], &error);
+    double compile = bench_now() - start;
+    for (size_t i = 0; i < count; i++)
+        if (functions[i] == NULL || functions[i]->code == NULL)
+        {
+            fprintf(stderr, "[ERROR] rule %zu was not compiled. %s\n", i, error.data ? error.data : "");
+            return 1;
+        }
+
+    // every rule takes a, b, c, d, e in that order, so one row of inputs serves them all.
+    double *inputs = malloc(rows * 5 * sizeof(double));
+    srand(42);
+    for (size_t i = 0; i < rows * 5; i++)
+        inputs[i] = (double)(rand() % 2000) / 10.0 - 50.0;
+
+    double walk_sum = 0, jit_sum = 0;
+    start = bench_now();
+    for (size_t row = 0; row < rows; row++)
+        for (size_t i = 0; i < count; i++)
+            walk_sum += eval_ast(exprs[i], &functions[i]->signature, &inputs[row * 5]);
+    double walk = bench_now() - start;
+    start = bench_now();
+    for (size_t row = 0; row < rows; row++)
+        for (size_t i = 0; i < count; i++)
+            jit_sum += functions[i]->code(&inputs[row * 5]);
+    double jitted = bench_now() - start;
+    if (walk_sum != jit_sum)
+    {
+        fprintf(stderr, "[ERROR] tree walk sums to %.17g, jitted code to %.17g.\n", walk_sum, jit_sum);
+        return 1;
+    }
+    double evaluations = (double)rows * (double)count;
+    printf("%zu rules, jit %.2f us/rule\n", count, compile / (double)count * 1e6);
+    printf("tree walk %.1f ns/eval, jit %.1f ns/eval (%.1fx)\n", walk / evaluations * 1e9, jitted / evaluations * 1e9,
+           walk / jitted);
+
+    for (size_t i = 0; i < count; i++)
+        jit_free(functions[i]);
+    free(functions);
+    free(inputs);
+    strbuf_free(&error);
+    ast_free(ast);
+    parser_free(parser);
+    lexer_free(lexer);
+    strbuf_free(&source);
+    return 0;
+}
@@ -0,0 +1,97 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lexer.h"
+#include "parser.h"
+#include "AST.h"
+#include "dtoa.h"
+#include "strbuf.h"
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+static void bench_collect(AST *ast, double *numbers, size_t *count)
+{
+    if (ast == NULL)
+        return;
+    if (ast->type == AST_NUMBER)
+        numbers[(*count)++] = ast->number;
+    bench_collect(ast->left, numbers, count);
+    bench_collect(ast->right, numbers, count);
+    bench_collect(ast->value, numbers, count);
+    for (size_t i = 0; i < array_size(&ast->childs); i++)
+        bench_collect(array_at(&ast->childs, i), numbers, count);
+}
+int main(int argc, char *argv[])
+{
+    size_t lines = argc > 1 ? (size_t)atol(argv[1]) : 50000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 10;
+    StrBuf source = init_strbuf();
+    unsigned seed = 12345;
+    for (size_t i = 0; i < lines; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        strbuf_printf(&source, "%u.%u * 0.%04u + %u - 3.14159 / %u.5;\n", seed % 100000, seed % 97, seed % 10000,
+                      seed % 1000, seed % 10);
+    }
+
+    Lexer *lexer = init_lexer(source.data, "bench");
+    Parser *parser = init_parser(lexer);
+    AST *ast = parser_parse(parser);
+    if (parser->had_error)
+    {
+        fprintf(stderr, "[ERROR] benchmark input failed to parse.\n");
+        return 1;
+    }
+    double *numbers = malloc(lines * 5 * sizeof(double));
+    size_t count = 0;
+    bench_collect(ast, numbers, &count);
+
+    StrBuf out = init_strbuf();
+    double best_printf = 0, best_dtoa = 0, best_emit = 0;
+    for (int round = 0; round < rounds; round++)
+    {
+        strbuf_reset(&out);
+        double start = bench_now();
+        for (size_t i = 0; i < count; i++)
+            strbuf_printf(&out, ",\"number\": \"%f\"", numbers[i]);
+        double elapsed_printf = bench_now() - start;
+
+        strbuf_reset(&out);
+        start = bench_now();
+        for (size_t i = 0; i < count; i++)
+        {
+            strbuf_puts(&out, ",\"number\": ");
+            strbuf_reserve(&out, DTOA_BUFFER_SIZE);
+            out.length += dtoa_shortest(numbers[i], out.data + out.length);
+        }
+        double elapsed_dtoa = bench_now() - start;
+
+        strbuf_reset(&out);
+        start = bench_now();
+        ast_write_json(&out, ast, NULL);
+        double elapsed_emit = bench_now() - start;
+
+        if (round == 0 || elapsed_printf < best_printf)
+            best_printf = elapsed_printf;
+        if (round == 0 || elapsed_dtoa < best_dtoa)
+            best_dtoa = elapsed_dtoa;
+        if (round == 0 || elapsed_emit < best_emit)
+            best_emit = elapsed_emit;
+    }
+    printf("%zu numbers: printf(\"%%f\") %.1f ns/number, dtoa_shortest %.1f ns/number\n", count,
+           best_printf * 1e9 / (double)count, best_dtoa * 1e9 / (double)count);
+    printf("ast_write_json: %zu bytes in %.3f ms\n", out.length, best_emit * 1e3);
+    strbuf_free(&out);
+    free(numbers);
+    ast_free(ast);
+    parser_free(parser);
+    lexer_free(lexer);
+    strbuf_free(&source);
+    return 0;
+}
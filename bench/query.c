@@ -0,0 +1,108 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lexer.h"
+#include "parser.h"
+#include "AST.h"
+#include "ast_index.h"
+#include "strbuf.h"
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+static size_t bench_walk_calls(AST *ast, const char *callee)
+{
+    if (ast == NULL)
+        return 0;
+    size_t found = ast->type == AST_FUNCTION_CALL && ast->left && ast->left->type == AST_ID &&
+                   strcmp(ast->left->name, callee) == 0;
+    found += bench_walk_calls(ast->value, callee);
+    found += bench_walk_calls(ast->left, callee);
+    found += bench_walk_calls(ast->right, callee);
+    for (size_t i = 0; i < array_size(&ast->childs); i++)
+        found += bench_walk_calls(array_at(&ast->childs, i), callee);
+    return found;
+}
+// under hash-consing f(1) is one node shared by all three decls, and it has to be listed once.
+static void bench_check_shared(void)
+{
+    Lexer *lexer = init_lexer("a = f(1); b = f(1); c = g(f(1));\n", "shared");
+    Parser *parser = init_parser(lexer);
+    parser_enable_hashcons(parser);
+    parser_enable_index(parser);
+    AST *ast = parser_parse(parser);
+    size_t calls = 0, ids = 0;
+    ast_index_calls(parser->index, "f", &calls);
+    ast_index_named(parser->index, AST_ID, "f", &ids);
+    if (calls != 1 || ids != 1)
+    {
+        fprintf(stderr, "[ERROR] shared f(1) is listed as %zu calls and %zu ids.\n", calls, ids);
+        exit(1);
+    }
+    ast_free(ast);
+    parser_free(parser);
+    lexer_free(lexer);
+}
+int main(int argc, char *argv[])
+{
+    bench_check_shared();
+    size_t lines = argc > 1 ? (size_t)atol(argv[1]) : 200000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 10;
+    StrBuf source = init_strbuf();
+    for (size_t i = 0; i < lines; i++)
+        strbuf_printf(&source, "a%zu = b + c * g%zu(x) - %s(y, z);\n", i, i % 1000, i % 100 ? "h" : "f");
+
+    double start = bench_now();
+    Lexer *lexer = init_lexer(source.data, "bench");
+    Parser *parser = init_parser(lexer);
+    AST *ast = parser_parse(parser);
+    double plain = bench_now() - start;
+    parser_free(parser);
+    lexer_free(lexer);
+    ast_free(ast);
+
+    start = bench_now();
+    lexer = init_lexer(source.data, "bench");
+    parser = init_parser(lexer);
+    parser_enable_index(parser);
+    ast = parser_parse(parser);
+    double indexed = bench_now() - start;
+    if (parser->had_error)
+    {
+        fprintf(stderr, "[ERROR] benchmark input failed to parse.\n");
+        return 1;
+    }
+
+    double best_walk = 0, best_index = 0;
+    size_t walk_found = 0, index_found = 0;
+    for (int round = 0; round < rounds; round++)
+    {
+        start = bench_now();
+        walk_found = bench_walk_calls(ast, "f");
+        double elapsed_walk = bench_now() - start;
+        start = bench_now();
+        ast_index_calls(parser->index, "f", &index_found);
+        double elapsed_index = bench_now() - start;
+        if (round == 0 || elapsed_walk < best_walk)
+            best_walk = elapsed_walk;
+        if (round == 0 || elapsed_index < best_index)
+            best_index = elapsed_index;
+    }
+    if (walk_found != index_found)
+    {
+        fprintf(stderr, "[ERROR] walk found %zu calls, index found %zu.\n", walk_found, index_found);
+        return 1;
+    }
+    printf("parse %.3f ms, with index %.3f ms\n", plain * 1e3, indexed * 1e3);
+    printf("calls to f (%zu): walk %.3f ms, index %.6f ms\n", index_found, best_walk * 1e3, best_index * 1e3);
+    ast_free(ast);
+    parser_free(parser);
+    lexer_free(lexer);
+    strbuf_free(&source);
+    return 0;
+}
@@ -0,0 +1,123 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lexer.h"
+#include "parser.h"
+#include "AST.h"
+
+#if defined(LEXER_SCALAR) || !defined(__SSE2__)
+#define RESYNC_NAME "scalar"
+#else
+#define RESYNC_NAME "sse2"
+#endif
+
+// every statement breaks on its second token, so nearly all of the input is skipped by error recovery.
+static const char *line = "total = count items where price > limit and stock < reorder_level or flagged;\n";
+
+// inputs that once crashed the parser; each must come back as diagnostics.
+static const char *hostile[] = {"1 = (;", "1 = (", "(;)(x);", "x = (1 +;)(2);"};
+
+static void bench_check_hostile(void)
+{
+    for (size_t i = 0; i < sizeof(hostile) / sizeof(hostile[0]); i++)
+    {
+        char *source = malloc(strlen(hostile[i]) + 1);
+        strcpy(source, hostile[i]);
+        Lexer *lexer = init_lexer(source, "hostile");
+        Parser *parser = init_parser(lexer);
+        AST *ast = parser_parse(parser);
+        if (!parser->had_error)
+        {
+            fprintf(stderr, "[ERROR] \"%s\" should not parse.\n", hostile[i]);
+            exit(1);
+        }
+        ast_free(ast);
+        parser_free(parser);
+        lexer_free(lexer);
+        free(source);
+    }
+}
+static void bench_drop_decl(AST *decl, void *data)
+{
+    (void)data;
+    ast_free(decl);
+}
+// fed a few bytes at a time, broken input must report the same diagnostics as parsed in one go.
+static void bench_check_streamed(const char *source, size_t chunk)
+{
+    char *whole_source = malloc(strlen(source) + 1);
+    strcpy(whole_source, source);
+    Lexer *whole_lexer = init_lexer(whole_source, "whole");
+    Parser *whole = init_parser(whole_lexer);
+    ast_free(parser_parse(whole));
+
+    Lexer *lexer = init_lexer("", "streamed");
+    Parser *parser = init_parser(lexer);
+    parser_stream(parser, bench_drop_decl, NULL);
+    size_t length = strlen(source);
+    for (size_t i = 0; i < length; i += chunk)
+        parser_feed(parser, source + i, length - i < chunk ? length - i : chunk);
+    parser_finish(parser);
+
+    int same = parser->had_error == whole->had_error &&
+               array_size(&parser->diagnostics) == array_size(&whole->diagnostics);
+    for (size_t i = 0; same && i < array_size(&parser->diagnostics); i++)
+    {
+        ParserDiagnostic *a = &array_at(&parser->diagnostics, i);
+        ParserDiagnostic *b = &array_at(&whole->diagnostics, i);
+        same = a->row == b->row && a->col == b->col && strcmp(a->message, b->message) == 0;
+    }
+    if (!same)
+    {
+        fprintf(stderr, "[ERROR] \"%s\" fed %zu bytes at a time: %zu diagnostics, %zu in one go.\n", source, chunk,
+                array_size(&parser->diagnostics), array_size(&whole->diagnostics));
+        exit(1);
+    }
+    parser_free(parser);
+    lexer_free(lexer);
+    parser_free(whole);
+    lexer_free(whole_lexer);
+    free(whole_source);
+}
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+int main(int argc, char *argv[])
+{
+    bench_check_hostile();
+    for (size_t chunk = 1; chunk <= 3; chunk++)
+        bench_check_streamed("a = 1 2 3; b;\n", chunk);
+    size_t lines = argc > 1 ? (size_t)atol(argv[1]) : 50000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 20;
+    size_t line_len = strlen(line);
+    char *source = malloc(lines * line_len + 1);
+    for (size_t i = 0; i < lines; i++)
+        memcpy(source + i * line_len, line, line_len);
+    source[lines * line_len] = '\0';
+
+    double best = 0;
+    size_t diagnostics = 0;
+    for (int round = 0; round < rounds; round++)
+    {
+        double start = bench_now();
+        Lexer *lexer = init_lexer(source, "bench");
+        Parser *parser = init_parser(lexer);
+        AST *ast = parser_parse(parser);
+        double elapsed = bench_now() - start;
+        diagnostics = array_size(&parser->diagnostics);
+        ast_free(ast);
+        parser_free(parser);
+        lexer_free(lexer);
+        if (round == 0 || elapsed < best)
+            best = elapsed;
+    }
+    printf("%s resync: %zu bytes, %zu diagnostics kept, in %.3f ms (%.1f MB/s)\n", RESYNC_NAME, lines * line_len,
+           diagnostics, best * 1e3, (double)(lines * line_len) / best / 1e6);
+    free(source);
+    return 0;
+}
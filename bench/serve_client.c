@@ -0,0 +1,158 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "serve.h"
+
+typedef struct
+{
+    const char *socket_path;
+    const char *source;
+    size_t source_len;
+    size_t requests;
+    double *latencies;
+    int failed;
+    pthread_t thread;
+} ClientThread;
+
+static double client_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+static int client_read_all(int fd, char *data, size_t length)
+{
+    while (length > 0)
+    {
+        ssize_t got = read(fd, data, length);
+        if (got <= 0)
+            return -1;
+        data += got;
+        length -= (size_t)got;
+    }
+    return 0;
+}
+static int client_write_all(int fd, const char *data, size_t length)
+{
+    while (length > 0)
+    {
+        ssize_t written = write(fd, data, length);
+        if (written <= 0)
+            return -1;
+        data += written;
+        length -= (size_t)written;
+    }
+    return 0;
+}
+static void *client_main(void *arg)
+{
+    ClientThread *client = arg;
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    strncpy(addr.sun_path, client->socket_path, sizeof(addr.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        client->failed = 1;
+        return NULL;
+    }
+    char header[SERVE_HEADER_SIZE];
+    uint32_t length = (uint32_t)client->source_len;
+    header[0] = (char)(length >> 24);
+    header[1] = (char)(length >> 16);
+    header[2] = (char)(length >> 8);
+    header[3] = (char)length;
+    header[4] = SERVE_FORMAT_JSON;
+    size_t capacity = 1 << 16;
+    char *response = malloc(capacity);
+
+    for (size_t i = 0; i < client->requests; i++)
+    {
+        double start = client_now();
+        if (client_write_all(fd, header, sizeof(header)) || client_write_all(fd, client->source, client->source_len) ||
+            client_read_all(fd, header, sizeof(header)))
+        {
+            client->failed = 1;
+            break;
+        }
+        size_t response_len = (size_t)((unsigned char)header[0]) << 24 | (size_t)((unsigned char)header[1]) << 16 |
+                              (size_t)((unsigned char)header[2]) << 8 | (size_t)(unsigned char)header[3];
+        if (response_len > capacity)
+        {
+            capacity = response_len;
+            response = realloc(response, capacity);
+        }
+        if (client_read_all(fd, response, response_len) || header[4] != SERVE_STATUS_OK)
+        {
+            client->failed = 1;
+            break;
+        }
+        client->latencies[i] = client_now() - start;
+        header[0] = (char)(length >> 24);
+        header[1] = (char)(length >> 16);
+        header[2] = (char)(length >> 8);
+        header[3] = (char)length;
+        header[4] = SERVE_FORMAT_JSON;
+    }
+    free(response);
+    close(fd);
+    return NULL;
+}
+static int client_compare(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "[ERROR] %s <socket> <expression> [requests] [connections]\n", argv[0]);
+        return 1;
+    }
+    size_t requests = argc > 3 ? (size_t)atol(argv[3]) : 10000;
+    int connections = argc > 4 ? atoi(argv[4]) : 1;
+    if (connections < 1)
+        connections = 1;
+    const char *source = argv[2];
+    size_t total = requests * (size_t)connections;
+    double *latencies = malloc(total * sizeof(double));
+    ClientThread *clients = calloc((size_t)connections, sizeof(ClientThread));
+
+    double start = client_now();
+    for (int i = 0; i < connections; i++)
+    {
+        clients[i].socket_path = argv[1];
+        clients[i].source = source;
+        clients[i].source_len = strlen(source);
+        clients[i].requests = requests;
+        clients[i].latencies = latencies + (size_t)i * requests;
+        pthread_create(&clients[i].thread, NULL, client_main, &clients[i]);
+    }
+    int failed = 0;
+    for (int i = 0; i < connections; i++)
+    {
+        pthread_join(clients[i].thread, NULL);
+        failed |= clients[i].failed;
+    }
+    double elapsed = client_now() - start;
+    if (failed)
+    {
+        fprintf(stderr, "[ERROR] request failed, is the server running on \"%s\"?\n", argv[1]);
+        return 1;
+    }
+    qsort(latencies, total, sizeof(double), client_compare);
+    printf("%zu requests over %d connections in %.3f s (%.0f req/s)\n", total, connections, elapsed,
+           (double)total / elapsed);
+    printf("p50 %.1f us  p99 %.1f us  max %.1f us\n", latencies[total / 2] * 1e6,
+           latencies[total * 99 / 100] * 1e6, latencies[total - 1] * 1e6);
+    free(clients);
+    free(latencies);
+    return 0;
+}
\ No newline at end of file
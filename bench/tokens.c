@@ -0,0 +1,90 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lexer.h"
+#include "parser.h"
+#include "AST.h"
+#include "strbuf.h"
+#include "token_stream.h"
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+int main(int argc, char *argv[])
+{
+    size_t lines = argc > 1 ? (size_t)atol(argv[1]) : 200000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 5;
+    StrBuf source = init_strbuf();
+    for (size_t i = 0; i < lines; i++)
+        strbuf_printf(&source, "a%zu = b + c * g%zu(x, \"s\") - (y ? %zu : z); // note\n", i, i % 1000, i % 7);
+
+    double json_best = 0, write_best = 0, read_best = 0;
+    size_t counts[GRAMMAR_TOKEN_COUNT] = {0};
+    size_t token_count = 0;
+    StrBuf stream_data = init_strbuf();
+    for (int round = 0; round < rounds; round++)
+    {
+        // what a token consumer had to do before: parse and dump the whole tree as JSON.
+        double start = bench_now();
+        Lexer *lexer = init_lexer(source.data, "bench");
+        Parser *parser = init_parser(lexer);
+        AST *ast = parser_parse(parser);
+        StrBuf json = init_strbuf();
+        ast_write_json(&json, ast, NULL);
+        double elapsed = bench_now() - start;
+        if (round == 0 || elapsed < json_best)
+            json_best = elapsed;
+        strbuf_free(&json);
+        ast_free(ast);
+        parser_free(parser);
+        lexer_free(lexer);
+
+        start = bench_now();
+        lexer = init_lexer(source.data, "bench");
+        strbuf_reset(&stream_data);
+        if (lexer_write_tokens(lexer, &stream_data, NULL) != 0)
+        {
+            fprintf(stderr, "[ERROR] benchmark input has error tokens.\n");
+            return 1;
+        }
+        elapsed = bench_now() - start;
+        if (round == 0 || elapsed < write_best)
+            write_best = elapsed;
+        lexer_free(lexer);
+
+        // a consumer over the stream: a histogram of token types and the line of every identifier.
+        start = bench_now();
+        TokenStream stream;
+        if (token_stream_open(&stream, stream_data.data, stream_data.length) != 0)
+        {
+            fprintf(stderr, "[ERROR] benchmark stream does not open.\n");
+            return 1;
+        }
+        token_count = stream.token_count;
+        memset(counts, 0, sizeof(counts));
+        size_t line_sum = 0;
+        for (size_t i = 0; i < stream.token_count; i++)
+        {
+            counts[stream.tokens[i].type]++;
+            if (stream.tokens[i].type == TOKEN_ID)
+                line_sum += token_stream_line(&stream, stream.tokens[i].offset);
+        }
+        elapsed = bench_now() - start;
+        if (round == 0 || elapsed < read_best)
+            read_best = elapsed;
+        if (line_sum == 0)
+            return 1;
+    }
+    printf("%zu bytes, %zu tokens, stream of %zu bytes\n", source.length, token_count,
+           stream_data.length);
+    printf("parse and json %.1f ms, write token stream %.1f ms (%.1f MB/s), read it back %.1f ms\n",
+           json_best * 1e3, write_best * 1e3, (double)source.length / write_best / 1e6, read_best * 1e3);
+    strbuf_free(&stream_data);
+    strbuf_free(&source);
+    return 0;
+}
@@ -0,0 +1,64 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "utf8.h"
+
+#if defined(UTF8_SCALAR)
+#define UTF8_NAME "scalar"
+#elif defined(__SSSE3__)
+#define UTF8_NAME "lookup"
+#else
+#define UTF8_NAME "sse2"
+#endif
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+static double bench_validate(const char *text, size_t length, int rounds)
+{
+    double best = 0;
+    for (int round = 0; round < rounds; round++)
+    {
+        double start = bench_now();
+        if (!utf8_valid(text, length))
+        {
+            fprintf(stderr, "[ERROR] benchmark input is not valid UTF-8.\n");
+            exit(1);
+        }
+        double elapsed = bench_now() - start;
+        if (round == 0 || elapsed < best)
+            best = elapsed;
+    }
+    return best;
+}
+static char *bench_fill(const char *line, size_t size, size_t *length)
+{
+    size_t line_len = strlen(line);
+    size_t lines = size / line_len;
+    char *text = malloc(lines * line_len + 1);
+    for (size_t i = 0; i < lines; i++)
+        memcpy(text + i * line_len, line, line_len);
+    *length = lines * line_len;
+    return text;
+}
+int main(int argc, char *argv[])
+{
+    size_t size = argc > 1 ? (size_t)atol(argv[1]) : 16 * 1024 * 1024;
+    int rounds = argc > 2 ? atoi(argv[2]) : 10;
+    size_t ascii_len;
+    size_t intl_len;
+    char *ascii = bench_fill("total = price * count + shipping(order, \"standard delivery\");\n", size, &ascii_len);
+    char *intl = bench_fill("größe = 変数 + \"Grüße aus Köln, 東京の天気は晴れ\" + π * 𝑥;\n", size, &intl_len);
+    double ascii_time = bench_validate(ascii, ascii_len, rounds);
+    double intl_time = bench_validate(intl, intl_len, rounds);
+    printf("%s utf8: ascii %.0f MB/s, international %.0f MB/s\n", UTF8_NAME, (double)ascii_len / ascii_time / 1e6,
+           (double)intl_len / intl_time / 1e6);
+    free(ascii);
+    free(intl);
+    return 0;
+}
@@ -0,0 +1,276 @@
+#define _DEFAULT_SOURCE
+#include "cache.h"
+#include "helper.h"
+#include "parser.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+#define CACHE_MAGIC "pratt-cache"
+#define CACHE_CHECK_SEED 0x70726174746b6579ULL
+#define CACHE_STALE_TMP_SECONDS 3600
+
+typedef struct
+{
+    char *name;
+    off_t size;
+    struct timespec mtime;
+} DiskCacheEntry;
+
+DiskCache *init_disk_cache(const char *dir, size_t max_bytes)
+{
+    if (mkdir(dir, 0777) != 0 && errno != EEXIST)
+    {
+        fprintf(stderr, "[ERROR] cannot create cache directory \"%s\": %s.\n", dir, strerror(errno));
+        return NULL;
+    }
+    DiskCache *cache = calloc(1, sizeof(DiskCache));
+    cache->dir = strdup(dir);
+    cache->max_bytes = max_bytes;
+    return cache;
+}
+uint64_t disk_cache_key(const char *source, size_t length, uint64_t options)
+{
+    uint64_t seed = helper_hash64(PARSER_VERSION, strlen(PARSER_VERSION), options);
+    return helper_hash64(source, length, seed);
+}
+static char *disk_cache_path(DiskCache *cache, const char *name)
+{
+    size_t length = strlen(cache->dir) + strlen(name) + 2;
+    char *path = malloc(length);
+    snprintf(path, length, "%s/%s", cache->dir, name);
+    return path;
+}
+static char *disk_cache_entry_path(DiskCache *cache, uint64_t key)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.ast", (unsigned long long)key);
+    return disk_cache_path(cache, name);
+}
+// the header repeats the source length and a second hash so a key collision reads as a miss.
+static int disk_cache_header(char *buffer, size_t size, const char *source, size_t length)
+{
+    uint64_t check = helper_hash64(source, length, CACHE_CHECK_SEED);
+    return snprintf(buffer, size, "%s %s %zu %016llx\n", CACHE_MAGIC, PARSER_VERSION, length,
+                    (unsigned long long)check);
+}
+char *disk_cache_get(DiskCache *cache, uint64_t key, const char *source, size_t length, size_t *output_length)
+{
+    char *path = disk_cache_entry_path(cache, key);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        free(path);
+        return NULL;
+    }
+    struct stat st;
+    char header[128];
+    int header_length = disk_cache_header(header, sizeof(header), source, length);
+    char *data = NULL;
+    if (fstat(fd, &st) == 0 && st.st_size >= header_length)
+    {
+        size_t size = (size_t)st.st_size;
+        data = malloc(size + 1);
+        size_t got = 0;
+        while (got < size)
+        {
+            ssize_t n = read(fd, data + got, size - got);
+            if (n <= 0)
+                break;
+            got += (size_t)n;
+        }
+        if (got != size || memcmp(data, header, (size_t)header_length) != 0)
+        {
+            free(data);
+            data = NULL;
+        }
+        else
+        {
+            *output_length = size - (size_t)header_length;
+            memmove(data, data + header_length, *output_length);
+            data[*output_length] = '\0';
+        }
+    }
+    close(fd);
+    if (data)
+        utimensat(AT_FDCWD, path, NULL, 0);
+    free(path);
+    return data;
+}
+static int disk_cache_compare(const void *a, const void *b)
+{
+    const DiskCacheEntry *x = a;
+    const DiskCacheEntry *y = b;
+    if (x->mtime.tv_sec != y->mtime.tv_sec)
+        return (x->mtime.tv_sec > y->mtime.tv_sec) - (x->mtime.tv_sec < y->mtime.tv_sec);
+    return (x->mtime.tv_nsec > y->mtime.tv_nsec) - (x->mtime.tv_nsec < y->mtime.tv_nsec);
+}
+// walks the directory, drops stale temporary files and, past max_bytes, the least recently used entries;
+// returns the bytes left.
+static size_t disk_cache_scan(DiskCache *cache)
+{
+    DIR *dir = opendir(cache->dir);
+    if (dir == NULL)
+        return 0;
+    DiskCacheEntry *entries = NULL;
+    size_t count = 0, capacity = 0;
+    size_t total = 0;
+    time_t now = time(NULL);
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL)
+    {
+        int is_tmp = strncmp(ent->d_name, ".tmp-", 5) == 0;
+        if (!is_tmp && strstr(ent->d_name, ".ast") == NULL)
+            continue;
+        char *path = disk_cache_path(cache, ent->d_name);
+        struct stat st;
+        if (stat(path, &st) != 0)
+        {
+            free(path);
+            continue;
+        }
+        if (is_tmp)
+        {
+            if (now - st.st_mtime > CACHE_STALE_TMP_SECONDS)
+                unlink(path);
+            free(path);
+            continue;
+        }
+        if (count == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 64;
+            entries = realloc(entries, capacity * sizeof(DiskCacheEntry));
+        }
+        entries[count++] = (DiskCacheEntry){.name = path, .size = st.st_size, .mtime = st.st_mtim};
+        total += (size_t)st.st_size;
+    }
+    closedir(dir);
+
+    if (total > cache->max_bytes)
+    {
+        // evict down to 90% so the next few writes do not rescan.
+        size_t target = cache->max_bytes / 10 * 9;
+        qsort(entries, count, sizeof(DiskCacheEntry), disk_cache_compare);
+        for (size_t i = 0; i < count && total > target; i++)
+        {
+            if (unlink(entries[i].name) == 0 || errno == ENOENT)
+                total -= (size_t)entries[i].size;
+        }
+    }
+    for (size_t i = 0; i < count; i++)
+        free(entries[i].name);
+    free(entries);
+    return total;
+}
+// the lock file holds the running size of the cache, so a write only scans the directory when that size
+// crosses max_bytes or is missing. rewriting a key counts twice; the next scan corrects it.
+// 0 when the size could not be stored, which only costs the next writer a scan.
+static int disk_cache_account(DiskCache *cache, size_t added)
+{
+    char *lock_path = disk_cache_path(cache, ".lock");
+    int lock = open(lock_path, O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+    free(lock_path);
+    if (lock < 0)
+        return 0;
+    if (flock(lock, LOCK_EX) != 0)
+    {
+        close(lock);
+        return 0;
+    }
+    char text[32];
+    ssize_t got = pread(lock, text, sizeof(text) - 1, 0);
+    size_t total = SIZE_MAX;
+    if (got > 0)
+    {
+        text[got] = '\0';
+        char *end;
+        unsigned long long stored = strtoull(text, &end, 10);
+        if (end != text && *end == '\n')
+            total = (size_t)stored + added;
+    }
+    if (total > cache->max_bytes)
+        total = disk_cache_scan(cache);
+    int length = snprintf(text, sizeof(text), "%zu\n", total);
+    int stored = pwrite(lock, text, (size_t)length, 0) == length && ftruncate(lock, length) == 0;
+    flock(lock, LOCK_UN);
+    close(lock);
+    return stored;
+}
+void disk_cache_put(DiskCache *cache, uint64_t key, const char *source, size_t length, const char *output,
+                    size_t output_length)
+{
+    char header[128];
+    int header_length = disk_cache_header(header, sizeof(header), source, length);
+    char *tmp_path = disk_cache_path(cache, ".tmp-XXXXXX");
+    int fd = mkstemp(tmp_path);
+    if (fd < 0)
+    {
+        free(tmp_path);
+        return;
+    }
+    int ok = write(fd, header, (size_t)header_length) == header_length;
+    size_t written = 0;
+    while (ok && written < output_length)
+    {
+        ssize_t n = write(fd, output + written, output_length - written);
+        if (n <= 0)
+            ok = 0;
+        else
+            written += (size_t)n;
+    }
+    fchmod(fd, 0644);
+    ok = close(fd) == 0 && ok;
+    char *path = disk_cache_entry_path(cache, key);
+    if (!ok || rename(tmp_path, path) != 0)
+    {
+        unlink(tmp_path);
+        ok = 0;
+    }
+    free(path);
+    free(tmp_path);
+    if (ok)
+        disk_cache_account(cache, (size_t)header_length + output_length);
+}
+void disk_cache_free(DiskCache *cache)
+{
+    if (cache == NULL)
+        return;
+    free(cache->dir);
+    free(cache);
+}
+#else
+DiskCache *init_disk_cache(const char *dir, size_t max_bytes)
+{
+    (void)max_bytes;
+    fprintf(stderr, "[ERROR] cache directory \"%s\" is not supported on this platform.\n", dir);
+    return NULL;
+}
+uint64_t disk_cache_key(const char *source, size_t length, uint64_t options)
+{
+    return helper_hash64(source, length, options);
+}
+char *disk_cache_get(DiskCache *cache, uint64_t key, const char *source, size_t length, size_t *output_length)
+{
+    (void)cache, (void)key, (void)source, (void)length, (void)output_length;
+    return NULL;
+}
+void disk_cache_put(DiskCache *cache, uint64_t key, const char *source, size_t length, const char *output,
+                    size_t output_length)
+{
+    (void)cache, (void)key, (void)source, (void)length, (void)output, (void)output_length;
+}
+void disk_cache_free(DiskCache *cache)
+{
+    (void)cache;
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,257 @@
+#include "dtoa.h"
+#include <stdint.h>
+#include <string.h>
+
+// Grisu2 (Florian Loitsch, "Printing Floating-Point Numbers Quickly and Accurately with Integers").
+// the output always reads back to the same double and is the shortest such string in all but rare cases.
+
+typedef struct
+{
+    uint64_t f;
+    int e;
+} DiyFp;
+
+#define DTOA_SIGNIFICAND_SIZE 52
+#define DTOA_EXPONENT_BIAS (0x3FF + DTOA_SIGNIFICAND_SIZE)
+#define DTOA_HIDDEN_BIT 0x0010000000000000ULL
+#define DTOA_FRACTION_MASK 0x000FFFFFFFFFFFFFULL
+#define DTOA_EXPONENT_MASK 0x7FF0000000000000ULL
+
+// generated by tools/gen_dtoa_powers.py
+static const uint64_t dtoa_cached_f[] = {
+    0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL, 0xcf42894a5dce35eaULL,
+    0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL, 0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL,
+    0xbe5691ef416bd60cULL, 0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+    0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL, 0xc21094364dfb5637ULL,
+    0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL, 0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL,
+    0xb23867fb2a35b28eULL, 0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+    0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL, 0xb5b5ada8aaff80b8ULL,
+    0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL, 0x964e858c91ba2655ULL, 0xdff9772470297ebdULL,
+    0xa6dfbd9fb8e5b88fULL, 0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+    0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL, 0xaa242499697392d3ULL,
+    0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL, 0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL,
+    0x9c40000000000000ULL, 0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+    0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL, 0x9f4f2726179a2245ULL,
+    0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL, 0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL,
+    0x924d692ca61be758ULL, 0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+    0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL, 0x952ab45cfa97a0b3ULL,
+    0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL, 0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL,
+    0x88fcf317f22241e2ULL, 0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+    0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL, 0x8bab8eefb6409c1aULL,
+    0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL, 0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL,
+    0x80444b5e7aa7cf85ULL, 0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+    0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL,
+};
+static const int16_t dtoa_cached_e[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+    -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+    -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+    -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+    -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+    109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+    641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+    907, 933, 960, 986, 1013, 1039, 1066,
+};
+
+static const uint64_t dtoa_pow10[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL,
+    10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL,
+    1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL,
+    10000000000000000000ULL,
+};
+
+static DiyFp dtoa_diyfp(uint64_t f, int e)
+{
+    DiyFp fp = {f, e};
+    return fp;
+}
+static DiyFp dtoa_multiply(DiyFp x, DiyFp y)
+{
+    const uint64_t mask = 0xFFFFFFFFULL;
+    uint64_t a = x.f >> 32, b = x.f & mask, c = y.f >> 32, d = y.f & mask;
+    uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t tmp = (bd >> 32) + (ad & mask) + (bc & mask);
+    tmp += 1ULL << 31;
+    return dtoa_diyfp(ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), x.e + y.e + 64);
+}
+static DiyFp dtoa_normalize(DiyFp x)
+{
+    int shift = __builtin_clzll(x.f);
+    return dtoa_diyfp(x.f << shift, x.e - shift);
+}
+static void dtoa_boundaries(DiyFp v, DiyFp *minus, DiyFp *plus)
+{
+    DiyFp pl = dtoa_normalize(dtoa_diyfp((v.f << 1) + 1, v.e - 1));
+    DiyFp mi = v.f == DTOA_HIDDEN_BIT ? dtoa_diyfp((v.f << 2) - 1, v.e - 2) : dtoa_diyfp((v.f << 1) - 1, v.e - 1);
+    mi.f <<= mi.e - pl.e;
+    mi.e = pl.e;
+    *plus = pl;
+    *minus = mi;
+}
+static DiyFp dtoa_cached_power(int e, int *k)
+{
+    double dk = (-61 - e) * 0.30102999566398114 + 347;
+    int ik = (int)dk;
+    if (dk - ik > 0.0)
+        ik++;
+    unsigned index = (unsigned)((ik >> 3) + 1);
+    *k = -(-348 + (int)(index << 3));
+    return dtoa_diyfp(dtoa_cached_f[index], dtoa_cached_e[index]);
+}
+static void dtoa_round(char *buffer, size_t length, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t wp_w)
+{
+    while (rest < wp_w && delta - rest >= ten_kappa &&
+           (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w))
+    {
+        buffer[length - 1]--;
+        rest += ten_kappa;
+    }
+}
+static int dtoa_count_digits(uint32_t n)
+{
+    int digits = 1;
+    while (digits < 10 && n >= dtoa_pow10[digits])
+        digits++;
+    return digits;
+}
+static size_t dtoa_digits(DiyFp w, DiyFp mp, uint64_t delta, char *buffer, int *k)
+{
+    DiyFp one = dtoa_diyfp(1ULL << -mp.e, mp.e);
+    uint64_t wp_w = mp.f - w.f;
+    uint32_t p1 = (uint32_t)(mp.f >> -one.e);
+    uint64_t p2 = mp.f & (one.f - 1);
+    int kappa = dtoa_count_digits(p1);
+    size_t length = 0;
+
+    while (kappa > 0)
+    {
+        uint32_t divisor = (uint32_t)dtoa_pow10[kappa - 1];
+        uint32_t digit = p1 / divisor;
+        p1 %= divisor;
+        if (digit || length)
+            buffer[length++] = (char)('0' + digit);
+        kappa--;
+        uint64_t rest = ((uint64_t)p1 << -one.e) + p2;
+        if (rest <= delta)
+        {
+            *k += kappa;
+            dtoa_round(buffer, length, delta, rest, dtoa_pow10[kappa] << -one.e, wp_w);
+            return length;
+        }
+    }
+    for (;;)
+    {
+        p2 *= 10;
+        delta *= 10;
+        char digit = (char)(p2 >> -one.e);
+        if (digit || length)
+            buffer[length++] = (char)('0' + digit);
+        p2 &= one.f - 1;
+        kappa--;
+        if (p2 < delta)
+        {
+            *k += kappa;
+            dtoa_round(buffer, length, delta, p2, one.f, -kappa < 20 ? wp_w * dtoa_pow10[-kappa] : 0);
+            return length;
+        }
+    }
+}
+static size_t dtoa_grisu2(double value, char *buffer, int *k)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    int biased_e = (int)((bits & DTOA_EXPONENT_MASK) >> DTOA_SIGNIFICAND_SIZE);
+    uint64_t significand = bits & DTOA_FRACTION_MASK;
+    DiyFp v = biased_e ? dtoa_diyfp(significand + DTOA_HIDDEN_BIT, biased_e - DTOA_EXPONENT_BIAS)
+                       : dtoa_diyfp(significand, 1 - DTOA_EXPONENT_BIAS);
+
+    DiyFp w_m, w_p;
+    dtoa_boundaries(v, &w_m, &w_p);
+    DiyFp c_mk = dtoa_cached_power(w_p.e, k);
+    DiyFp w = dtoa_multiply(dtoa_normalize(v), c_mk);
+    DiyFp wp = dtoa_multiply(w_p, c_mk);
+    DiyFp wm = dtoa_multiply(w_m, c_mk);
+    wm.f++;
+    wp.f--;
+    return dtoa_digits(w, wp, wp.f - wm.f, buffer, k);
+}
+static size_t dtoa_exponent(int k, char *buffer)
+{
+    size_t length = 0;
+    if (k < 0)
+    {
+        buffer[length++] = '-';
+        k = -k;
+    }
+    if (k >= 100)
+    {
+        buffer[length++] = (char)('0' + k / 100);
+        k %= 100;
+        buffer[length++] = (char)('0' + k / 10);
+    }
+    else if (k >= 10)
+        buffer[length++] = (char)('0' + k / 10);
+    buffer[length++] = (char)('0' + k % 10);
+    return length;
+}
+// lays the digits out as plain decimal when that stays short, otherwise as d.ddde[-]x.
+static size_t dtoa_prettify(char *buffer, size_t length, int k)
+{
+    int digits = (int)length;
+    int kk = digits + k;
+    if (k >= 0 && kk <= 21)
+    {
+        memset(buffer + length, '0', (size_t)k);
+        return (size_t)kk;
+    }
+    if (kk > 0 && kk <= 21)
+    {
+        memmove(buffer + kk + 1, buffer + kk, (size_t)(digits - kk));
+        buffer[kk] = '.';
+        return length + 1;
+    }
+    if (kk > -6 && kk <= 0)
+    {
+        size_t offset = (size_t)(2 - kk);
+        memmove(buffer + offset, buffer, length);
+        buffer[0] = '0';
+        buffer[1] = '.';
+        memset(buffer + 2, '0', (size_t)-kk);
+        return length + offset;
+    }
+    if (digits == 1)
+    {
+        buffer[1] = 'e';
+        return 2 + dtoa_exponent(kk - 1, buffer + 2);
+    }
+    memmove(buffer + 2, buffer + 1, length - 1);
+    buffer[1] = '.';
+    buffer[length + 1] = 'e';
+    return length + 2 + dtoa_exponent(kk - 1, buffer + length + 2);
+}
+size_t dtoa_shortest(double value, char *buffer)
+{
+    if (value != value || value - value != 0)
+    {
+        memcpy(buffer, "null", 5);
+        return 4;
+    }
+    size_t sign = 0;
+    if (value < 0 || (value == 0 && 1 / value < 0))
+    {
+        buffer[sign++] = '-';
+        value = -value;
+    }
+    if (value == 0)
+    {
+        buffer[sign] = '0';
+        buffer[sign + 1] = '\0';
+        return sign + 1;
+    }
+    int k = 0;
+    size_t length = dtoa_grisu2(value, buffer + sign, &k);
+    length = sign + dtoa_prettify(buffer + sign, length, k);
+    buffer[length] = '\0';
+    return length;
+}
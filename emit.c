@@ -0,0 +1,211 @@
+#include "emit.h"
+#include "strbuf.h"
+#include "array.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+// a piece of the output in document order: text the walk wrote itself, or a range of a wide node's children
+// that a worker writes.
+typedef struct
+{
+    StrBuf out;
+    AST *ast;
+    size_t begin;
+    size_t end;
+} EmitPiece;
+
+typedef struct
+{
+    AST_JsonOptions *options;
+    define_array(pieces, EmitPiece);
+    size_t ranges;
+    size_t range_count;
+    atomic_size_t next;
+} EmitJob;
+
+static void *emit_worker(void *arg)
+{
+    EmitJob *job = arg;
+    size_t piece;
+    while ((piece = atomic_fetch_add(&job->next, 1)) < job->pieces.count)
+    {
+        EmitPiece *range = &job->pieces.items[piece];
+        if (range->ast == NULL)
+            continue;
+        size_t count = array_size(&range->ast->childs);
+        // same separators as ast_json_node, including its comma after every child but the last slot.
+        for (size_t i = range->begin; i < range->end; i++)
+        {
+            AST *child = array_at(&range->ast->childs, i);
+            if (child)
+            {
+                ast_write_json(&range->out, child, job->options);
+                if (i != count - 1)
+                    strbuf_putc(&range->out, ',');
+            }
+        }
+    }
+    return NULL;
+}
+// the text piece the walk appends to; a new one after a range.
+static StrBuf *emit_text(EmitJob *job)
+{
+    if (job->pieces.count == 0 || job->pieces.items[job->pieces.count - 1].ast)
+    {
+        EmitPiece text = {.out = init_strbuf()};
+        array_push(&job->pieces, text);
+    }
+    return &job->pieces.items[job->pieces.count - 1].out;
+}
+// writes ast like ast_json_node, but leaves the children of every wide node, at any depth, to the workers.
+static void emit_walk(EmitJob *job, AST *ast)
+{
+    ast_write_json_label(emit_text(job), ast);
+    if (ast->left != NULL)
+    {
+        strbuf_puts(emit_text(job), ",\"left\": ");
+        emit_walk(job, ast->left);
+    }
+    if (ast->right != NULL)
+    {
+        strbuf_puts(emit_text(job), ",\"right\": ");
+        emit_walk(job, ast->right);
+    }
+    if (ast->value != NULL)
+    {
+        strbuf_puts(emit_text(job), ",\"value\": ");
+        emit_walk(job, ast->value);
+    }
+    size_t count = array_size(&ast->childs);
+    if (count != 0)
+    {
+        strbuf_puts(emit_text(job), ",\"children\": [");
+        if (count >= EMIT_MIN_CHILDREN)
+        {
+            size_t size = (count + job->range_count - 1) / job->range_count;
+            for (size_t begin = 0; begin < count; begin += size)
+            {
+                EmitPiece range = {
+                    .out = init_strbuf(),
+                    .ast = ast,
+                    .begin = begin,
+                    .end = begin + size < count ? begin + size : count,
+                };
+                array_push(&job->pieces, range);
+                job->ranges++;
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                AST *child = array_at(&ast->childs, i);
+                if (child)
+                {
+                    emit_walk(job, child);
+                    if (i != count - 1)
+                        strbuf_putc(emit_text(job), ',');
+                }
+            }
+        }
+        strbuf_putc(emit_text(job), ']');
+    }
+    strbuf_putc(emit_text(job), '}');
+}
+static int emit_writev_all(int fd, struct iovec *iov, size_t count)
+{
+    while (count > 0)
+    {
+        int batch = count < IOV_MAX ? (int)count : IOV_MAX;
+        ssize_t written = writev(fd, iov, batch);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        size_t left = (size_t)written;
+        while (count > 0 && left >= iov->iov_len)
+        {
+            left -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0)
+        {
+            iov->iov_base = (char *)iov->iov_base + left;
+            iov->iov_len -= left;
+        }
+    }
+    return 0;
+}
+static int emit_parallel(FILE *file, AST *ast, AST_JsonOptions *options, int jobs)
+{
+    EmitJob job = {
+        .options = options,
+        .range_count = (size_t)jobs * 8,
+    };
+    init_array(&job.pieces);
+    atomic_init(&job.next, 0);
+    emit_walk(&job, ast);
+    strbuf_putc(emit_text(&job), '\n');
+
+    // a tree without wide nodes was written by the walk alone.
+    if (job.ranges)
+    {
+        pthread_t *threads = calloc((size_t)jobs, sizeof(pthread_t));
+        int started = 0;
+        for (; started < jobs - 1; started++)
+            if (pthread_create(&threads[started], NULL, emit_worker, &job) != 0)
+                break;
+        emit_worker(&job);
+        for (int i = 0; i < started; i++)
+            pthread_join(threads[i], NULL);
+        free(threads);
+    }
+
+    struct iovec *iov = calloc(job.pieces.count, sizeof(struct iovec));
+    for (size_t i = 0; i < job.pieces.count; i++)
+    {
+        iov[i].iov_base = job.pieces.items[i].out.data;
+        iov[i].iov_len = job.pieces.items[i].out.length;
+    }
+    fflush(file);
+    int status = emit_writev_all(fileno(file), iov, job.pieces.count);
+    free(iov);
+    for (size_t i = 0; i < job.pieces.count; i++)
+        strbuf_free(&job.pieces.items[i].out);
+    array_free(&job.pieces);
+    return status;
+}
+#endif
+int ast_emit_json(FILE *file, AST *ast, AST_JsonOptions *options, int jobs)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    // "ref" ids follow document order, so shared output has to come from a single walk.
+    int shared = options && options->share_refs;
+    if (ast && jobs > 1 && !shared)
+        return emit_parallel(file, ast, options, jobs);
+#else
+    (void)jobs;
+#endif
+    StrBuf out = init_strbuf();
+    ast_write_json(&out, ast, options);
+    strbuf_putc(&out, '\n');
+    size_t written = fwrite(out.data, 1, out.length, file);
+    int status = written == out.length ? 0 : -1;
+    strbuf_free(&out);
+    return status;
+}
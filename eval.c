@@ -0,0 +1,308 @@
+#include "eval.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const EvalBuiltin eval_builtins[] = {
+    {"sqrt", 1, sqrt, NULL},
+    {"exp", 1, exp, NULL},
+    {"log", 1, log, NULL},
+    {"sin", 1, sin, NULL},
+    {"cos", 1, cos, NULL},
+    {"tan", 1, tan, NULL},
+    {"fabs", 1, fabs, NULL},
+    {"floor", 1, floor, NULL},
+    {"ceil", 1, ceil, NULL},
+    {"pow", 2, NULL, pow},
+    {"fmin", 2, NULL, fmin},
+    {"fmax", 2, NULL, fmax},
+    {"fmod", 2, NULL, fmod},
+    {"atan2", 2, NULL, atan2},
+};
+
+const EvalBuiltin *eval_builtin(const char *name)
+{
+    for (size_t i = 0; i < sizeof(eval_builtins) / sizeof(eval_builtins[0]); i++)
+        if (strcmp(eval_builtins[i].name, name) == 0)
+            return &eval_builtins[i];
+    return NULL;
+}
+// operator nodes keep their text in name.
+EvalOp eval_op(const AST *ast)
+{
+    const char *name = ast->name;
+    if (name == NULL)
+        return EVAL_OP_NONE;
+    int unary = ast->type == AST_UNARY || ast->type == AST_POSTFIX;
+    switch (name[0])
+    {
+    case '+':
+        return name[1] == '+' ? EVAL_OP_INC : EVAL_OP_ADD;
+    case '-':
+        return name[1] == '-' ? EVAL_OP_DEC : unary ? EVAL_OP_NEG : EVAL_OP_SUB;
+    case '*':
+        return EVAL_OP_MUL;
+    case '/':
+        return EVAL_OP_DIV;
+    case '%':
+        return EVAL_OP_MOD;
+    case '=':
+        return name[1] == '=' ? EVAL_OP_EQ : EVAL_OP_ASSIGN;
+    case '!':
+        return name[1] == '=' ? EVAL_OP_NE : EVAL_OP_NOT;
+    case '<':
+        return name[1] == '<' ? EVAL_OP_SHL : name[1] == '=' ? EVAL_OP_LE : EVAL_OP_LT;
+    case '>':
+        return name[1] == '>' ? EVAL_OP_SHR : name[1] == '=' ? EVAL_OP_GE : EVAL_OP_GT;
+    case '&':
+        return name[1] == '&' ? EVAL_OP_AND : EVAL_OP_BIT_AND;
+    case '|':
+        return name[1] == '|' ? EVAL_OP_OR : EVAL_OP_BIT_OR;
+    case '~':
+        return EVAL_OP_BIT_NOT;
+    default:
+        return EVAL_OP_NONE;
+    }
+}
+AST **eval_call_args(AST *call, size_t *count)
+{
+    if (call->value == NULL)
+    {
+        *count = 0;
+        return NULL;
+    }
+    if (call->value->type == AST_SEQUENCEEXPR)
+    {
+        *count = array_size(&call->value->childs);
+        return call->value->childs.items;
+    }
+    *count = 1;
+    return &call->value;
+}
+size_t eval_param(const EvalSignature *signature, const char *name)
+{
+    for (size_t i = 0; i < signature->param_count; i++)
+        if (strcmp(signature->params[i], name) == 0)
+            return i;
+    return signature->param_count;
+}
+static void eval_add_param(EvalSignature *signature, char *name)
+{
+    if (eval_param(signature, name) < signature->param_count)
+        return;
+    if (signature->param_count == signature->param_capacity)
+    {
+        signature->param_capacity = signature->param_capacity ? signature->param_capacity * 2 : 8;
+        signature->params = realloc(signature->params, signature->param_capacity * sizeof(char *));
+    }
+    signature->params[signature->param_count++] = name;
+}
+static const char *eval_fail(EvalSignature *signature, AST *ast, const char *message)
+{
+    signature->bad = ast;
+    return message;
+}
+static const char *eval_check_node(AST *ast, EvalSignature *signature)
+{
+    if (ast == NULL)
+        return eval_fail(signature, ast, "missing operand.");
+    const char *message = NULL;
+    EvalOp op = eval_op(ast);
+    switch (ast->type)
+    {
+    case AST_NUMBER:
+    case AST_TRUE:
+    case AST_FALSE:
+    case AST_NULL:
+        return NULL;
+    case AST_ID:
+        eval_add_param(signature, ast->name);
+        return NULL;
+    case AST_BINARY:
+        if (op == EVAL_OP_NONE || op >= EVAL_OP_NEG)
+            return eval_fail(signature, ast, "unknown binary operator.");
+        if (op != EVAL_OP_ASSIGN && (message = eval_check_node(ast->left, signature)) != NULL)
+            return message;
+        if (op == EVAL_OP_ASSIGN && (ast->left == NULL || ast->left->type != AST_ID))
+            return eval_fail(signature, ast, "only a parameter can be assigned.");
+        if (op == EVAL_OP_ASSIGN)
+            eval_add_param(signature, ast->left->name);
+        return eval_check_node(ast->right, signature);
+    case AST_UNARY:
+    case AST_POSTFIX:
+        if (op == EVAL_OP_INC || op == EVAL_OP_DEC)
+        {
+            if (ast->value == NULL || ast->value->type != AST_ID)
+                return eval_fail(signature, ast, "only a parameter can be incremented or decremented.");
+            eval_add_param(signature, ast->value->name);
+            return NULL;
+        }
+        if (ast->type == AST_POSTFIX || (op != EVAL_OP_NEG && op != EVAL_OP_NOT && op != EVAL_OP_BIT_NOT))
+            return eval_fail(signature, ast, "unknown unary operator.");
+        return eval_check_node(ast->value, signature);
+    case AST_TERNARY:
+        if ((message = eval_check_node(ast->value, signature)) != NULL ||
+            (message = eval_check_node(ast->left, signature)) != NULL)
+            return message;
+        return eval_check_node(ast->right, signature);
+    case AST_SEQUENCEEXPR:
+        for (size_t i = 0; i < array_size(&ast->childs); i++)
+            if ((message = eval_check_node(array_at(&ast->childs, i), signature)) != NULL)
+                return message;
+        return NULL;
+    case AST_FUNCTION_CALL:
+    {
+        const EvalBuiltin *builtin = ast->left && ast->left->type == AST_ID ? eval_builtin(ast->left->name) : NULL;
+        if (builtin == NULL)
+            return eval_fail(signature, ast, "only math builtins can be called.");
+        size_t count;
+        AST **args = eval_call_args(ast, &count);
+        if (count != builtin->arity)
+            return eval_fail(signature, ast, "wrong number of arguments to a builtin.");
+        for (size_t i = 0; i < count; i++)
+            if ((message = eval_check_node(args[i], signature)) != NULL)
+                return message;
+        return NULL;
+    }
+    case AST_STRING:
+        return eval_fail(signature, ast, "strings are not numeric.");
+    default:
+        return eval_fail(signature, ast, "statements cannot be evaluated.");
+    }
+}
+const char *eval_check(AST *expr, EvalSignature *signature)
+{
+    memset(signature, 0, sizeof(EvalSignature));
+    return eval_check_node(expr, signature);
+}
+void eval_signature_free(EvalSignature *signature)
+{
+    free(signature->params);
+    memset(signature, 0, sizeof(EvalSignature));
+}
+int64_t eval_int(double value)
+{
+    if (value != value)
+        return 0;
+    if (value >= 9223372036854775807.0)
+        return INT64_MAX;
+    if (value <= -9223372036854775808.0)
+        return INT64_MIN;
+    return (int64_t)value;
+}
+
+typedef struct
+{
+    const EvalSignature *signature;
+    double *locals;
+} EvalFrame;
+
+static double eval_node(AST *ast, EvalFrame *frame)
+{
+    switch (ast->type)
+    {
+    case AST_NUMBER:
+        return ast->number;
+    case AST_TRUE:
+        return 1;
+    case AST_FALSE:
+    case AST_NULL:
+        return 0;
+    case AST_ID:
+        return frame->locals[eval_param(frame->signature, ast->name)];
+    case AST_BINARY:
+    {
+        EvalOp op = eval_op(ast);
+        if (op == EVAL_OP_ASSIGN)
+            return frame->locals[eval_param(frame->signature, ast->left->name)] = eval_node(ast->right, frame);
+        double left = eval_node(ast->left, frame);
+        if (op == EVAL_OP_AND)
+            return left != 0 && eval_node(ast->right, frame) != 0;
+        if (op == EVAL_OP_OR)
+            return left != 0 || eval_node(ast->right, frame) != 0;
+        double right = eval_node(ast->right, frame);
+        switch (op)
+        {
+        case EVAL_OP_ADD:
+            return left + right;
+        case EVAL_OP_SUB:
+            return left - right;
+        case EVAL_OP_MUL:
+            return left * right;
+        case EVAL_OP_DIV:
+            return left / right;
+        case EVAL_OP_MOD:
+            return fmod(left, right);
+        case EVAL_OP_EQ:
+            return left == right;
+        case EVAL_OP_NE:
+            return left != right;
+        case EVAL_OP_LT:
+            return left < right;
+        case EVAL_OP_LE:
+            return left <= right;
+        case EVAL_OP_GT:
+            return left > right;
+        case EVAL_OP_GE:
+            return left >= right;
+        case EVAL_OP_BIT_AND:
+            return (double)(eval_int(left) & eval_int(right));
+        case EVAL_OP_BIT_OR:
+            return (double)(eval_int(left) | eval_int(right));
+        case EVAL_OP_SHL:
+            return (double)(int64_t)((uint64_t)eval_int(left) << (eval_int(right) & 63));
+        case EVAL_OP_SHR:
+            return (double)(eval_int(left) >> (eval_int(right) & 63));
+        default:
+            return NAN;
+        }
+    }
+    case AST_UNARY:
+    case AST_POSTFIX:
+    {
+        EvalOp op = eval_op(ast);
+        if (op == EVAL_OP_INC || op == EVAL_OP_DEC)
+        {
+            double *local = &frame->locals[eval_param(frame->signature, ast->value->name)];
+            double old = *local;
+            *local += op == EVAL_OP_INC ? 1 : -1;
+            return ast->type == AST_POSTFIX ? old : *local;
+        }
+        double value = eval_node(ast->value, frame);
+        if (op == EVAL_OP_NEG)
+            return -value;
+        if (op == EVAL_OP_NOT)
+            return value == 0;
+        return (double)~eval_int(value);
+    }
+    case AST_TERNARY:
+        return eval_node(ast->value, frame) != 0 ? eval_node(ast->left, frame) : eval_node(ast->right, frame);
+    case AST_SEQUENCEEXPR:
+    {
+        double value = 0;
+        for (size_t i = 0; i < array_size(&ast->childs); i++)
+            value = eval_node(array_at(&ast->childs, i), frame);
+        return value;
+    }
+    case AST_FUNCTION_CALL:
+    {
+        const EvalBuiltin *builtin = eval_builtin(ast->left->name);
+        size_t count;
+        AST **args = eval_call_args(ast, &count);
+        double first = eval_node(args[0], frame);
+        if (builtin->arity == 1)
+            return builtin->unary(first);
+        return builtin->binary(first, eval_node(args[1], frame));
+    }
+    default:
+        return NAN;
+    }
+}
+double eval_ast(AST *expr, const EvalSignature *signature, const double *args)
+{
+    double locals[signature->param_count + 1];
+    if (signature->param_count)
+        memcpy(locals, args, signature->param_count * sizeof(double));
+    EvalFrame frame = {signature, locals};
+    return eval_node(expr, &frame);
+}
@@ -0,0 +1,113 @@
+// generated by tools/gen_grammar.py from grammar.spec, do not edit.
+#include "grammar.h"
+
+const char *const grammar_token_names[GRAMMAR_TOKEN_COUNT] = {
+    "TOKEN_ID",
+    "TOKEN_NUMBER",
+    "TOKEN_PLUS",
+    "TOKEN_MINUS",
+    "TOKEN_MUL",
+    "TOKEN_DIV",
+    "TOKEN_LPAREN",
+    "TOKEN_RPAREN",
+    "TOKEN_SEMICOLON",
+    "TOKEN_EOF",
+    "TOKEN_VAR",
+    "TOKEN_FUNCTION",
+    "TOKEN_IF",
+    "TOKEN_ELSE",
+    "TOKEN_FOR",
+    "TOKEN_WHILE",
+    "TOKEN_PRINT",
+    "TOKEN_RETURN",
+    "TOKEN_ERROR",
+    "TOKEN_COMMA",
+    "TOKEN_COLON",
+    "TOKEN_QUESTION",
+    "TOKEN_TRUE",
+    "TOKEN_FALSE",
+    "TOKEN_NULL",
+    "TOKEN_STRING",
+    "TOKEN_EQUALS",
+    "TOKEN_ASSIGNMENT",
+    "TOKEN_NOT",
+    "TOKEN_NOT_EQUALS",
+    "TOKEN_MOD",
+    "TOKEN_RIGHT_SHIFT",
+    "TOKEN_LTE",
+    "TOKEN_LT",
+    "TOKEN_LEFT_SHIFT",
+    "TOKEN_GTE",
+    "TOKEN_GT",
+    "TOKEN_AND",
+    "TOKEN_BITWISE_AND",
+    "TOKEN_OR",
+    "TOKEN_BITWISE_OR",
+    "TOKEN_INCREMENT",
+    "TOKEN_DECREMENT",
+    "TOKEN_BITWISE_NOT",
+    "TOKEN_LCURLY",
+    "TOKEN_RCURLY",
+};
+const char *const grammar_precedence_names[GRAMMAR_PRECEDENCE_COUNT] = {
+    "PREC_NONE",
+    "PREC_COMMA",
+    "PREC_ASSIGNMENT",
+    "PREC_TERNARY",
+    "PREC_LOGICAL_OR",
+    "PREC_LOGICAL_AND",
+    "PREC_BITWISE_OR",
+    "PREC_BITWISE_XOR",
+    "PREC_BITWISE_AND",
+    "PREC_EQUALITY",
+    "PREC_COMPARISON",
+    "PREC_SHIFT",
+    "PREC_TERM",
+    "PREC_FACTOR",
+    "PREC_UNARY",
+    "PREC_POSTIFX",
+};
+const char *const grammar_stmt_keywords[GRAMMAR_STMT_KEYWORD_COUNT] = {
+    "var",
+    "function",
+    "if",
+    "for",
+    "while",
+    "print",
+    "return",
+};
+
+const GrammarKeyword grammar_keywords[32] = {
+    {NULL, 0, TOKEN_ID},
+    {"while", 5, TOKEN_WHILE},
+    {NULL, 0, TOKEN_ID},
+    {NULL, 0, TOKEN_ID},
+    {NULL, 0, TOKEN_ID},
+    {NULL, 0, TOKEN_ID},
+    {"return", 6, TOKEN_RETURN},
+    {NULL, 0, TOKEN_ID},
+    {NULL, 0, TOKEN_ID},
+    {"print", 5, TOKEN_PRINT},
+    {NULL, 0, TOKEN_ID},
+    {"var", 3, TOKEN_VAR},
+    {NULL, 0, TOKEN_ID},
+    {NULL, 0, TOKEN_ID},
+    {"else", 4, TOKEN_ELSE},
+    {NULL, 0, TOKEN_ID},
+    {"false", 5, TOKEN_FALSE},
+    {"if", 2, TOKEN_IF},
+    {NULL, 0, TOKEN_ID},
+    {NULL, 0, TOKEN_ID},
+    {NULL, 0, TOKEN_ID},
+    {NULL, 0, TOKEN_ID},
+    {NULL, 0, TOKEN_ID},
+    {NULL, 0, TOKEN_ID},
+    {NULL, 0, TOKEN_ID},
+    {NULL, 0, TOKEN_ID},
+    {NULL, 0, TOKEN_ID},
+    {"for", 3, TOKEN_FOR},
+    {"function", 8, TOKEN_FUNCTION},
+    {"true", 4, TOKEN_TRUE},
+    {"null", 4, TOKEN_NULL},
+    {NULL, 0, TOKEN_ID},
+};
@@ -0,0 +1,106 @@
+# Tokens, operators, keywords, precedence levels and Pratt rules of the language.
+# tools/gen_grammar.py turns this file into includes/grammar.h and grammar.c; `make` reruns it when it changes.
+#
+# token NAME                        built by hand in lexer.c (identifiers, numbers, strings, EOF, errors)
+# op NAME TEXT                      matched by the operator DFA, longest match wins
+# keyword NAME TEXT [stmt]          reserved word; stmt ones start a statement when recovering from errors
+# prec NAME                         precedence level, lowest first
+# rule NAME PREFIX INFIX PREC ASSOC parser_parse_PREFIX / parser_parse_INFIX, '-' for none; ASSOC is left or right
+#
+# Tokens are numbered in the order they appear here; '#' starts a comment.
+
+token ID
+token NUMBER
+op PLUS +
+op MINUS -
+op MUL *
+op DIV /
+op LPAREN (
+op RPAREN )
+op SEMICOLON ;
+token EOF
+keyword VAR var stmt
+keyword FUNCTION function stmt
+keyword IF if stmt
+keyword ELSE else
+keyword FOR for stmt
+keyword WHILE while stmt
+keyword PRINT print stmt
+keyword RETURN return stmt
+token ERROR
+op COMMA ,
+op COLON :
+op QUESTION ?
+keyword TRUE true
+keyword FALSE false
+keyword NULL null
+token STRING
+op EQUALS ==
+op ASSIGNMENT =
+op NOT !
+op NOT_EQUALS !=
+op MOD %
+op RIGHT_SHIFT >>
+op LTE <=
+op LT <
+op LEFT_SHIFT <<
+op GTE >=
+op GT >
+op AND &&
+op BITWISE_AND &
+op OR ||
+op BITWISE_OR |
+op INCREMENT ++
+op DECREMENT --
+op BITWISE_NOT ~
+op LCURLY {
+op RCURLY }
+
+prec NONE
+prec COMMA       # ,
+prec ASSIGNMENT  # =
+prec TERNARY     # ?:
+prec LOGICAL_OR  # ||
+prec LOGICAL_AND # &&
+prec BITWISE_OR  # |
+prec BITWISE_XOR # ^
+prec BITWISE_AND # &
+prec EQUALITY    # == !=
+prec COMPARISON  # < > <= >=
+prec SHIFT       # >> <<
+prec TERM        # + -
+prec FACTOR      # * / %
+prec UNARY       # ! - ++ --
+prec POSTIFX     # () ++ --
+
+rule LPAREN group call POSTIFX left
+rule MINUS prefix infix TERM left
+rule PLUS - infix TERM left
+rule DIV - infix FACTOR left
+rule MUL - infix FACTOR left
+rule NUMBER number - NONE left
+rule COMMA - comma COMMA left
+rule QUESTION - ternary TERNARY right
+rule TRUE primary - NONE left
+rule FALSE primary - NONE left
+rule NULL primary - NONE left
+rule ID primary - NONE left
+rule STRING string - NONE left
+rule EQUALS - infix EQUALITY left
+rule ASSIGNMENT - infix ASSIGNMENT right
+rule NOT prefix - NONE left
+rule NOT_EQUALS - infix EQUALITY left
+rule MOD - infix FACTOR left
+rule RIGHT_SHIFT - infix SHIFT left
+rule LEFT_SHIFT - infix SHIFT left
+rule AND - infix LOGICAL_AND left
+rule BITWISE_AND - infix BITWISE_AND left
+rule OR - infix LOGICAL_OR left
+rule BITWISE_OR - infix BITWISE_OR left
+rule LTE - infix COMPARISON left
+rule LT - infix COMPARISON left
+rule GTE - infix COMPARISON left
+rule GT - infix COMPARISON left
+rule BITWISE_NOT prefix - NONE left
+rule INCREMENT prefix postfix UNARY left
+rule DECREMENT prefix postfix UNARY left
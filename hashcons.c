@@ -0,0 +1,145 @@
+#include "hashcons.h"
+#include "helper.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+HashCons *init_hashcons(void)
+{
+    HashCons *table = calloc(1, sizeof(HashCons));
+    table->capacity = 256;
+    table->slots = calloc(table->capacity, sizeof(AST *));
+    assert(table->slots != NULL && "cannot allocate memory");
+    return table;
+}
+static uint64_t hashcons_mix(uint64_t hash, uint64_t value)
+{
+    return helper_hash64(&value, sizeof(value), hash);
+}
+// children are already canonical, so their hashes stand in for the whole subtree.
+uint64_t hashcons_hash(AST *ast)
+{
+    uint64_t hash = hashcons_mix((uint64_t)ast->type, 0);
+    if (ast->name)
+        hash = helper_hash64(ast->name, strlen(ast->name), hash);
+    if (ast->type == AST_NUMBER)
+    {
+        uint64_t bits;
+        memcpy(&bits, &ast->number, sizeof(bits));
+        hash = hashcons_mix(hash, bits);
+    }
+    hash = hashcons_mix(hash, ast->value ? ast->value->hash : 1);
+    hash = hashcons_mix(hash, ast->left ? ast->left->hash : 2);
+    hash = hashcons_mix(hash, ast->right ? ast->right->hash : 3);
+    for (size_t i = 0; i < array_size(&ast->childs); i++)
+    {
+        AST *child = array_at(&ast->childs, i);
+        hash = hashcons_mix(hash, child ? child->hash : 4);
+    }
+    return hash;
+}
+static int hashcons_equal(AST *a, AST *b)
+{
+    if (a->hash != b->hash || a->type != b->type)
+        return 0;
+    if ((a->name == NULL) != (b->name == NULL))
+        return 0;
+    if (a->name && strcmp(a->name, b->name) != 0)
+        return 0;
+    if (a->type == AST_NUMBER && memcmp(&a->number, &b->number, sizeof(a->number)) != 0)
+        return 0;
+    if (a->value != b->value || a->left != b->left || a->right != b->right)
+        return 0;
+    if (array_size(&a->childs) != array_size(&b->childs))
+        return 0;
+    for (size_t i = 0; i < array_size(&a->childs); i++)
+    {
+        if (array_at(&a->childs, i) != array_at(&b->childs, i))
+            return 0;
+    }
+    return 1;
+}
+static void hashcons_grow(HashCons *table)
+{
+    size_t capacity = table->capacity * 2;
+    AST **slots = calloc(capacity, sizeof(AST *));
+    assert(slots != NULL && "cannot allocate memory");
+    for (size_t i = 0; i < table->capacity; i++)
+    {
+        AST *ast = table->slots[i];
+        if (ast == NULL)
+            continue;
+        size_t slot = (size_t)ast->hash & (capacity - 1);
+        while (slots[slot] != NULL)
+            slot = (slot + 1) & (capacity - 1);
+        slots[slot] = ast;
+    }
+    free(table->slots);
+    table->slots = slots;
+    table->capacity = capacity;
+}
+// drops a freshly built duplicate; its children stay alive through the canonical copy.
+static void hashcons_release_shell(AST *ast)
+{
+    if (ast->flags & AST_FLAG_ARENA)
+        return;
+    small_array_free(&ast->childs);
+    free(ast->name);
+    free(ast);
+}
+static void hashcons_unref_children(AST *ast)
+{
+    if (ast->value)
+        ast->value->refcount--;
+    if (ast->left)
+        ast->left->refcount--;
+    if (ast->right)
+        ast->right->refcount--;
+    for (size_t i = 0; i < array_size(&ast->childs); i++)
+    {
+        AST *child = array_at(&ast->childs, i);
+        if (child)
+            child->refcount--;
+    }
+}
+AST *hashcons_intern(HashCons *table, AST *ast)
+{
+    if (ast == NULL)
+        return NULL;
+    ast->hash = hashcons_hash(ast);
+    size_t mask = table->capacity - 1;
+    size_t slot = (size_t)ast->hash & mask;
+    while (table->slots[slot] != NULL)
+    {
+        AST *canonical = table->slots[slot];
+        if (canonical == ast)
+            return ast;
+        if (hashcons_equal(canonical, ast))
+        {
+            hashcons_unref_children(ast);
+            hashcons_release_shell(ast);
+            canonical->refcount++;
+            table->shared++;
+            return canonical;
+        }
+        slot = (slot + 1) & mask;
+    }
+    table->slots[slot] = ast;
+    table->count++;
+    if (table->count * 4 >= table->capacity * 3)
+        hashcons_grow(table);
+    return ast;
+}
+void hashcons_clear(HashCons *table)
+{
+    memset(table->slots, 0, table->capacity * sizeof(AST *));
+    table->count = 0;
+    table->shared = 0;
+}
+void hashcons_free(HashCons *table)
+{
+    if (table == NULL)
+        return;
+    free(table->slots);
+    free(table);
+}
\ No newline at end of file
@@ -1,4 +1,12 @@
 #include "helper.h"
+#include <string.h>
+
+#define HASH_PRIME1 11400714785074694791ULL
+#define HASH_PRIME2 14029467366897019727ULL
+#define HASH_PRIME3 1609587929392839161ULL
+#define HASH_PRIME4 9650029242287828579ULL
+#define HASH_PRIME5 2870177450012600261ULL
+
 int helper_num_places(int n)
 {
     if (n < 0)
@@ -22,4 +30,90 @@ int helper_num_places(int n)
     if (n < 100000000)
         return 9;
     return 10;
+}
+static uint64_t helper_rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+static uint64_t helper_read64(const unsigned char *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+static uint32_t helper_read32(const unsigned char *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+static uint64_t helper_hash_round(uint64_t acc, uint64_t input)
+{
+    acc += input * HASH_PRIME2;
+    acc = helper_rotl64(acc, 31);
+    return acc * HASH_PRIME1;
+}
+static uint64_t helper_hash_merge(uint64_t acc, uint64_t val)
+{
+    acc ^= helper_hash_round(0, val);
+    return acc * HASH_PRIME1 + HASH_PRIME4;
+}
+// XXH64 over the raw bytes; callers persist these so the algorithm must stay stable.
+uint64_t helper_hash64(const void *data, size_t length, uint64_t seed)
+{
+    const unsigned char *p = data;
+    const unsigned char *end = p + length;
+    uint64_t h;
+
+    if (length >= 32)
+    {
+        uint64_t v1 = seed + HASH_PRIME1 + HASH_PRIME2;
+        uint64_t v2 = seed + HASH_PRIME2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - HASH_PRIME1;
+        const unsigned char *limit = end - 32;
+        do
+        {
+            v1 = helper_hash_round(v1, helper_read64(p));
+            v2 = helper_hash_round(v2, helper_read64(p + 8));
+            v3 = helper_hash_round(v3, helper_read64(p + 16));
+            v4 = helper_hash_round(v4, helper_read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        h = helper_rotl64(v1, 1) + helper_rotl64(v2, 7) + helper_rotl64(v3, 12) + helper_rotl64(v4, 18);
+        h = helper_hash_merge(h, v1);
+        h = helper_hash_merge(h, v2);
+        h = helper_hash_merge(h, v3);
+        h = helper_hash_merge(h, v4);
+    }
+    else
+    {
+        h = seed + HASH_PRIME5;
+    }
+    h += (uint64_t)length;
+
+    while (p + 8 <= end)
+    {
+        h ^= helper_hash_round(0, helper_read64(p));
+        h = helper_rotl64(h, 27) * HASH_PRIME1 + HASH_PRIME4;
+        p += 8;
+    }
+    if (p + 4 <= end)
+    {
+        h ^= (uint64_t)helper_read32(p) * HASH_PRIME1;
+        h = helper_rotl64(h, 23) * HASH_PRIME2 + HASH_PRIME3;
+        p += 4;
+    }
+    while (p < end)
+    {
+        h ^= (*p) * HASH_PRIME5;
+        h = helper_rotl64(h, 11) * HASH_PRIME1;
+        p++;
+    }
+    h ^= h >> 33;
+    h *= HASH_PRIME2;
+    h ^= h >> 29;
+    h *= HASH_PRIME3;
+    h ^= h >> 32;
+    return h;
 }
\ No newline at end of file
@@ -2,6 +2,10 @@
 #define AST_H
 #include "token.h"
 #include "array.h"
+#include "strbuf.h"
+#include "arena.h"
+#include <stdint.h>
+#include <stdio.h>
 
 typedef enum
 {
@@ -21,7 +25,12 @@ typedef enum
     AST_FUNCTION_CALL,
     AST_SEQUENCEEXPR,
     AST_IF,
+    AST_TYPE_COUNT,
 } AST_Type;
+
+#define AST_FLAG_ARENA 1
+// most blocks and sequences are this short, so their children need no allocation of their own.
+#define AST_INLINE_CHILDREN 2
 typedef struct AST_STRUCT AST;
 struct AST_STRUCT
 {
@@ -32,11 +41,33 @@ struct AST_STRUCT
     AST *left;
     AST *right;
     Token token;
-    define_array(childs, AST *);
+    uint64_t hash;
+    size_t refcount;
+    unsigned flags;
+    define_small_array(childs, AST *, AST_INLINE_CHILDREN);
 };
+typedef struct
+{
+    int share_refs;
+} AST_JsonOptions;
+typedef struct
+{
+    int share_refs;
+    int integer_keys;
+    FILE *flush;
+} AST_CborOptions;
 AST *init_ast(AST_Type type);
+Arena *ast_use_arena(Arena *arena);
+char *ast_token_text(Token token);
 char *ast_type_to_str(int type);
+char *ast_to_json(AST *ast);
+void ast_write_json(StrBuf *out, AST *ast, AST_JsonOptions *options);
+// an unclosed object with type, name and number; the caller adds the rest of the node.
+void ast_write_json_label(StrBuf *out, AST *ast);
 void ast_print(AST *root);
+void ast_write_cbor(StrBuf *out, AST *ast, AST_CborOptions *options);
+void ast_print_with(AST *root, AST_JsonOptions *options);
 size_t ast_push(AST *ast, AST *child);
+void ast_shrink(AST *ast);
 void ast_free(AST *ast);
 #endif
\ No newline at end of file
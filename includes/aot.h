@@ -0,0 +1,40 @@
+#ifndef AOT_H
+#define AOT_H
+#include <stddef.h>
+#include "AST.h"
+#include "strbuf.h"
+
+// one compiled expression; the generated translation unit declares pratt_aot_table with this same layout.
+typedef struct
+{
+    const char *name;
+    const char *const *params;
+    size_t param_count;
+    double (*call)(const double *args);
+} AotEntry;
+
+typedef struct
+{
+    const char *cc;
+    const char *optimize;
+    const char *dir;
+    const char *prefix;
+} AotOptions;
+
+typedef struct
+{
+    void *handle;
+    const AotEntry *entries;
+    size_t count;
+    char *dir;
+    int owns_dir;
+} AotModule;
+
+// NULL options mean $CC (or cc), -O2, a fresh directory under $TMPDIR and functions named expr_0, expr_1...
+// writes one function per expression taking its identifiers as double parameters, plus pratt_aot_table.
+int aot_write_c(StrBuf *out, AST **exprs, size_t count, const AotOptions *options, StrBuf *error);
+// builds the generated C into a shared object and loads it; NULL with the reason or compiler output in error.
+AotModule *aot_compile(AST **exprs, size_t count, const AotOptions *options, StrBuf *error);
+const AotEntry *aot_lookup(const AotModule *module, const char *name);
+void aot_module_free(AotModule *module);
+#endif
@@ -0,0 +1,26 @@
+#ifndef ARENA_H
+#define ARENA_H
+#include <stddef.h>
+
+typedef struct ArenaChunk ArenaChunk;
+struct ArenaChunk
+{
+    ArenaChunk *next;
+    size_t size;
+    size_t used;
+    unsigned char data[];
+};
+typedef struct
+{
+    ArenaChunk *head;
+    size_t chunk_size;
+    size_t allocated;
+    size_t reserved;
+} Arena;
+
+Arena *init_arena(size_t chunk_size);
+void *arena_alloc(Arena *arena, size_t size);
+char *arena_strndup(Arena *arena, const char *str, size_t length);
+void arena_reset(Arena *arena);
+void arena_free(Arena *arena);
+#endif
\ No newline at end of file
@@ -1,6 +1,9 @@
 #ifndef FU_ARRAY_H
 #define FU_ARRAY_H
 #include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 #define define_array(name, type) \
@@ -30,6 +33,67 @@
         (array)->items[(array)->count++] = (item);                                                 \
     } while (0)
 
+// like define_array, but the first inline_capacity items live in the struct and the heap is only used past them.
+#define define_small_array(name, type, inline_capacity) \
+    struct                                              \
+    {                                                   \
+        type *items;                                    \
+        uint32_t count;                                 \
+        uint32_t capacity;                              \
+        type inline_items[inline_capacity];             \
+    } name
+#define init_small_array(name)                                                                         \
+    do                                                                                                 \
+    {                                                                                                  \
+        (name)->items = (name)->inline_items;                                                          \
+        (name)->count = 0;                                                                             \
+        (name)->capacity = (uint32_t)(sizeof((name)->inline_items) / sizeof(*(name)->inline_items)); \
+    } while (0)
+
+#define small_array_push(array, item)                                                                  \
+    do                                                                                                 \
+    {                                                                                                  \
+        if ((array)->count >= (array)->capacity)                                                       \
+        {                                                                                              \
+            assert((array)->capacity < UINT32_MAX / 2 && "small array is too large");                  \
+            (array)->capacity *= 2;                                                                    \
+            if ((array)->items == (array)->inline_items)                                               \
+            {                                                                                          \
+                (array)->items = malloc((array)->capacity * sizeof(*(array)->items));                  \
+                assert((array)->items != NULL && "cannot allocate memory");                            \
+                memcpy((array)->items, (array)->inline_items, sizeof((array)->inline_items));          \
+            }                                                                                          \
+            else                                                                                       \
+            {                                                                                          \
+                (array)->items = realloc((array)->items, (array)->capacity * sizeof(*(array)->items)); \
+                assert((array)->items != NULL && "cannot allocate memory");                            \
+            }                                                                                          \
+        }                                                                                              \
+        (array)->items[(array)->count++] = (item);                                                     \
+    } while (0)
+
+// gives back the unused tail of a heap-backed small array once it stops growing.
+#define small_array_shrink(array)                                                                  \
+    do                                                                                             \
+    {                                                                                              \
+        if ((array)->items != (array)->inline_items && (array)->count < (array)->capacity)         \
+        {                                                                                          \
+            void *shrunk = realloc((array)->items, (array)->count * sizeof(*(array)->items));      \
+            if (shrunk)                                                                            \
+            {                                                                                      \
+                (array)->items = shrunk;                                                           \
+                (array)->capacity = (array)->count;                                                \
+            }                                                                                      \
+        }                                                                                          \
+    } while (0)
+
+#define small_array_free(array)                          \
+    do                                                   \
+    {                                                    \
+        if ((array)->items != (array)->inline_items)     \
+            free((array)->items);                        \
+    } while (0)
+
 #define array_pop(array) \
     (array)->items[--(array)->count]
 
@@ -0,0 +1,40 @@
+#ifndef AST_DIFF_H
+#define AST_DIFF_H
+#include "AST.h"
+#include "array.h"
+#include "strbuf.h"
+#include <stdint.h>
+
+typedef enum
+{
+    AST_EDIT_INSERT,
+    AST_EDIT_DELETE,
+    AST_EDIT_UPDATE,
+    AST_EDIT_MOVE,
+} ASTEditKind;
+
+// from is a JSON pointer into the old tree's JSON, to one into the new tree's; an insert has no from, a delete no to.
+typedef struct
+{
+    ASTEditKind kind;
+    AST *before;
+    AST *after;
+    char *from;
+    char *to;
+} ASTEdit;
+
+typedef struct
+{
+    define_array(edits, ASTEdit);
+    // node pairs looked at; it follows the size of the change, not of the trees.
+    size_t visited;
+} ASTDiff;
+
+// stores the hash of every subtree in its ast->hash, over type, name, number and the child hashes.
+uint64_t ast_merkle_hash(AST *ast);
+// hashes both trees, then only descends where the hashes differ; equal hashes count as equal subtrees.
+ASTDiff *ast_diff(AST *before, AST *after);
+// one JSON object per edit and line.
+void ast_diff_write_json(StrBuf *out, ASTDiff *diff);
+void ast_diff_free(ASTDiff *diff);
+#endif
@@ -0,0 +1,35 @@
+#ifndef AST_INDEX_H
+#define AST_INDEX_H
+#include "AST.h"
+#include <stdint.h>
+
+typedef struct
+{
+    uint64_t key;
+    define_array(nodes, AST *);
+} ASTIndexPostings;
+
+// per-type and per-(type, name) lists of nodes in document order; a call is keyed by its callee's name.
+typedef struct
+{
+    define_array(by_type[AST_TYPE_COUNT], AST *);
+    char **names;
+    size_t name_count;
+    uint32_t *name_slots;
+    size_t name_capacity;
+    ASTIndexPostings *named;
+    size_t named_count;
+    size_t named_capacity;
+    AST **seen;
+    size_t seen_count;
+    size_t seen_capacity;
+} ASTIndex;
+
+ASTIndex *init_ast_index(void);
+void ast_index_add(ASTIndex *index, AST *ast);
+AST **ast_index_of_type(ASTIndex *index, AST_Type type, size_t *count);
+AST **ast_index_named(ASTIndex *index, AST_Type type, const char *name, size_t *count);
+AST **ast_index_calls(ASTIndex *index, const char *callee, size_t *count);
+void ast_index_clear(ASTIndex *index);
+void ast_index_free(ASTIndex *index);
+#endif
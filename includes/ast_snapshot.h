@@ -0,0 +1,21 @@
+#ifndef AST_SNAPSHOT_H
+#define AST_SNAPSHOT_H
+#include <stdatomic.h>
+#include "AST.h"
+#include "arena.h"
+#include "ast_index.h"
+
+// a finished tree that is only read from now on; any thread holding a reference may walk it without locks.
+typedef struct
+{
+    const AST *root;
+    ASTIndex *index;
+    Arena *arena;
+    atomic_size_t refs;
+} ASTSnapshot;
+
+// takes over root, and the arena and index built with it when there are any; the caller holds the first reference.
+const ASTSnapshot *ast_freeze(AST *root, Arena *arena, ASTIndex *index);
+const ASTSnapshot *ast_snapshot_retain(const ASTSnapshot *snapshot);
+void ast_snapshot_release(const ASTSnapshot *snapshot);
+#endif
@@ -0,0 +1,18 @@
+#ifndef CACHE_H
+#define CACHE_H
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct
+{
+    char *dir;
+    size_t max_bytes;
+} DiskCache;
+
+DiskCache *init_disk_cache(const char *dir, size_t max_bytes);
+uint64_t disk_cache_key(const char *source, size_t length, uint64_t options);
+char *disk_cache_get(DiskCache *cache, uint64_t key, const char *source, size_t length, size_t *output_length);
+void disk_cache_put(DiskCache *cache, uint64_t key, const char *source, size_t length, const char *output,
+                    size_t output_length);
+void disk_cache_free(DiskCache *cache);
+#endif
\ No newline at end of file
@@ -0,0 +1,10 @@
+#ifndef DTOA_H
+#define DTOA_H
+#include <stddef.h>
+
+// longest output is "-1.2345678901234567e-308" plus the terminator.
+#define DTOA_BUFFER_SIZE 32
+
+// writes the shortest decimal that reads back as value; non-finite values become "null".
+size_t dtoa_shortest(double value, char *buffer);
+#endif
@@ -0,0 +1,12 @@
+#ifndef EMIT_H
+#define EMIT_H
+#include <stdio.h>
+#include "AST.h"
+
+// nodes with fewer children than this are not worth the threads.
+#define EMIT_MIN_CHILDREN 1024
+
+// writes the JSON for ast and a newline to file, splitting the children of every wide node across up to jobs
+// threads.
+int ast_emit_json(FILE *file, AST *ast, AST_JsonOptions *options, int jobs);
+#endif
@@ -0,0 +1,66 @@
+#ifndef EVAL_H
+#define EVAL_H
+#include <stddef.h>
+#include <stdint.h>
+#include "AST.h"
+
+typedef enum
+{
+    EVAL_OP_NONE,
+    EVAL_OP_ADD,
+    EVAL_OP_SUB,
+    EVAL_OP_MUL,
+    EVAL_OP_DIV,
+    EVAL_OP_MOD,
+    EVAL_OP_EQ,
+    EVAL_OP_NE,
+    EVAL_OP_LT,
+    EVAL_OP_LE,
+    EVAL_OP_GT,
+    EVAL_OP_GE,
+    EVAL_OP_AND,
+    EVAL_OP_OR,
+    EVAL_OP_BIT_AND,
+    EVAL_OP_BIT_OR,
+    EVAL_OP_SHL,
+    EVAL_OP_SHR,
+    EVAL_OP_ASSIGN,
+    EVAL_OP_NEG,
+    EVAL_OP_NOT,
+    EVAL_OP_BIT_NOT,
+    EVAL_OP_INC,
+    EVAL_OP_DEC,
+} EvalOp;
+
+// math.h functions an expression may call; they take and return doubles.
+typedef struct
+{
+    const char *name;
+    size_t arity;
+    double (*unary)(double);
+    double (*binary)(double, double);
+} EvalBuiltin;
+
+// the identifiers of one expression in order of first use; they become its parameters.
+typedef struct
+{
+    char **params;
+    size_t param_count;
+    size_t param_capacity;
+    AST *bad;
+} EvalSignature;
+
+// an expression is numeric when every value is a double: no strings, no statements, only builtin calls.
+// returns NULL and fills signature, or a message about signature->bad.
+const char *eval_check(AST *expr, EvalSignature *signature);
+void eval_signature_free(EvalSignature *signature);
+size_t eval_param(const EvalSignature *signature, const char *name);
+EvalOp eval_op(const AST *ast);
+const EvalBuiltin *eval_builtin(const char *name);
+// call arguments are NULL, one expression or a sequence of them.
+AST **eval_call_args(AST *call, size_t *count);
+// NaN is 0 and out-of-range values saturate, so bitwise operators never hit undefined conversions.
+int64_t eval_int(double value);
+// walks the tree left to right with args as the initial parameter values; args itself is not written.
+double eval_ast(AST *expr, const EvalSignature *signature, const double *args);
+#endif
@@ -0,0 +1,286 @@
+// generated by tools/gen_grammar.py from grammar.spec, do not edit.
+#ifndef GRAMMAR_H
+#define GRAMMAR_H
+#include <stddef.h>
+#include <string.h>
+
+typedef enum
+{
+    TOKEN_ID,
+    TOKEN_NUMBER,
+    TOKEN_PLUS,
+    TOKEN_MINUS,
+    TOKEN_MUL,
+    TOKEN_DIV,
+    TOKEN_LPAREN,
+    TOKEN_RPAREN,
+    TOKEN_SEMICOLON,
+    TOKEN_EOF,
+    TOKEN_VAR,
+    TOKEN_FUNCTION,
+    TOKEN_IF,
+    TOKEN_ELSE,
+    TOKEN_FOR,
+    TOKEN_WHILE,
+    TOKEN_PRINT,
+    TOKEN_RETURN,
+    TOKEN_ERROR,
+    TOKEN_COMMA,
+    TOKEN_COLON,
+    TOKEN_QUESTION,
+    TOKEN_TRUE,
+    TOKEN_FALSE,
+    TOKEN_NULL,
+    TOKEN_STRING,
+    TOKEN_EQUALS,
+    TOKEN_ASSIGNMENT,
+    TOKEN_NOT,
+    TOKEN_NOT_EQUALS,
+    TOKEN_MOD,
+    TOKEN_RIGHT_SHIFT,
+    TOKEN_LTE,
+    TOKEN_LT,
+    TOKEN_LEFT_SHIFT,
+    TOKEN_GTE,
+    TOKEN_GT,
+    TOKEN_AND,
+    TOKEN_BITWISE_AND,
+    TOKEN_OR,
+    TOKEN_BITWISE_OR,
+    TOKEN_INCREMENT,
+    TOKEN_DECREMENT,
+    TOKEN_BITWISE_NOT,
+    TOKEN_LCURLY,
+    TOKEN_RCURLY,
+} TokenType;
+
+typedef enum
+{
+    PREC_NONE,
+    PREC_COMMA,
+    PREC_ASSIGNMENT,
+    PREC_TERNARY,
+    PREC_LOGICAL_OR,
+    PREC_LOGICAL_AND,
+    PREC_BITWISE_OR,
+    PREC_BITWISE_XOR,
+    PREC_BITWISE_AND,
+    PREC_EQUALITY,
+    PREC_COMPARISON,
+    PREC_SHIFT,
+    PREC_TERM,
+    PREC_FACTOR,
+    PREC_UNARY,
+    PREC_POSTIFX,
+} Precedence;
+
+typedef enum
+{
+    GRAMMAR_ASSOC_LEFT,
+    GRAMMAR_ASSOC_RIGHT,
+} Associativity;
+
+#define GRAMMAR_TOKEN_COUNT 46
+#define GRAMMAR_PRECEDENCE_COUNT 16
+#define GRAMMAR_STMT_KEYWORD_COUNT 7
+
+// X(token, prefix, infix, precedence, associativity); tokens left out have no rule at all.
+#define PARSER_RULES(X)                                                                                       \
+    X(TOKEN_LPAREN, parser_parse_group, parser_parse_call, PREC_POSTIFX, GRAMMAR_ASSOC_LEFT)                  \
+    X(TOKEN_MINUS, parser_parse_prefix, parser_parse_infix, PREC_TERM, GRAMMAR_ASSOC_LEFT)                    \
+    X(TOKEN_PLUS, parser_parse_no_prefix, parser_parse_infix, PREC_TERM, GRAMMAR_ASSOC_LEFT)                  \
+    X(TOKEN_DIV, parser_parse_no_prefix, parser_parse_infix, PREC_FACTOR, GRAMMAR_ASSOC_LEFT)                 \
+    X(TOKEN_MUL, parser_parse_no_prefix, parser_parse_infix, PREC_FACTOR, GRAMMAR_ASSOC_LEFT)                 \
+    X(TOKEN_NUMBER, parser_parse_number, parser_parse_no_infix, PREC_NONE, GRAMMAR_ASSOC_LEFT)                \
+    X(TOKEN_COMMA, parser_parse_no_prefix, parser_parse_comma, PREC_COMMA, GRAMMAR_ASSOC_LEFT)                \
+    X(TOKEN_QUESTION, parser_parse_no_prefix, parser_parse_ternary, PREC_TERNARY, GRAMMAR_ASSOC_RIGHT)        \
+    X(TOKEN_TRUE, parser_parse_primary, parser_parse_no_infix, PREC_NONE, GRAMMAR_ASSOC_LEFT)                 \
+    X(TOKEN_FALSE, parser_parse_primary, parser_parse_no_infix, PREC_NONE, GRAMMAR_ASSOC_LEFT)                \
+    X(TOKEN_NULL, parser_parse_primary, parser_parse_no_infix, PREC_NONE, GRAMMAR_ASSOC_LEFT)                 \
+    X(TOKEN_ID, parser_parse_primary, parser_parse_no_infix, PREC_NONE, GRAMMAR_ASSOC_LEFT)                   \
+    X(TOKEN_STRING, parser_parse_string, parser_parse_no_infix, PREC_NONE, GRAMMAR_ASSOC_LEFT)                \
+    X(TOKEN_EQUALS, parser_parse_no_prefix, parser_parse_infix, PREC_EQUALITY, GRAMMAR_ASSOC_LEFT)            \
+    X(TOKEN_ASSIGNMENT, parser_parse_no_prefix, parser_parse_infix, PREC_ASSIGNMENT, GRAMMAR_ASSOC_RIGHT)     \
+    X(TOKEN_NOT, parser_parse_prefix, parser_parse_no_infix, PREC_NONE, GRAMMAR_ASSOC_LEFT)                   \
+    X(TOKEN_NOT_EQUALS, parser_parse_no_prefix, parser_parse_infix, PREC_EQUALITY, GRAMMAR_ASSOC_LEFT)        \
+    X(TOKEN_MOD, parser_parse_no_prefix, parser_parse_infix, PREC_FACTOR, GRAMMAR_ASSOC_LEFT)                 \
+    X(TOKEN_RIGHT_SHIFT, parser_parse_no_prefix, parser_parse_infix, PREC_SHIFT, GRAMMAR_ASSOC_LEFT)          \
+    X(TOKEN_LEFT_SHIFT, parser_parse_no_prefix, parser_parse_infix, PREC_SHIFT, GRAMMAR_ASSOC_LEFT)           \
+    X(TOKEN_AND, parser_parse_no_prefix, parser_parse_infix, PREC_LOGICAL_AND, GRAMMAR_ASSOC_LEFT)            \
+    X(TOKEN_BITWISE_AND, parser_parse_no_prefix, parser_parse_infix, PREC_BITWISE_AND, GRAMMAR_ASSOC_LEFT)    \
+    X(TOKEN_OR, parser_parse_no_prefix, parser_parse_infix, PREC_LOGICAL_OR, GRAMMAR_ASSOC_LEFT)              \
+    X(TOKEN_BITWISE_OR, parser_parse_no_prefix, parser_parse_infix, PREC_BITWISE_OR, GRAMMAR_ASSOC_LEFT)      \
+    X(TOKEN_LTE, parser_parse_no_prefix, parser_parse_infix, PREC_COMPARISON, GRAMMAR_ASSOC_LEFT)             \
+    X(TOKEN_LT, parser_parse_no_prefix, parser_parse_infix, PREC_COMPARISON, GRAMMAR_ASSOC_LEFT)              \
+    X(TOKEN_GTE, parser_parse_no_prefix, parser_parse_infix, PREC_COMPARISON, GRAMMAR_ASSOC_LEFT)             \
+    X(TOKEN_GT, parser_parse_no_prefix, parser_parse_infix, PREC_COMPARISON, GRAMMAR_ASSOC_LEFT)              \
+    X(TOKEN_BITWISE_NOT, parser_parse_prefix, parser_parse_no_infix, PREC_NONE, GRAMMAR_ASSOC_LEFT)           \
+    X(TOKEN_INCREMENT, parser_parse_prefix, parser_parse_postfix, PREC_UNARY, GRAMMAR_ASSOC_LEFT)             \
+    X(TOKEN_DECREMENT, parser_parse_prefix, parser_parse_postfix, PREC_UNARY, GRAMMAR_ASSOC_LEFT)
+
+extern const char *const grammar_token_names[GRAMMAR_TOKEN_COUNT];
+extern const char *const grammar_precedence_names[GRAMMAR_PRECEDENCE_COUNT];
+extern const char *const grammar_stmt_keywords[GRAMMAR_STMT_KEYWORD_COUNT];
+
+typedef struct
+{
+    const char *text;
+    size_t length;
+    TokenType type;
+} GrammarKeyword;
+
+// the lookups below run once per token, so they stay inline and only the table lives in grammar.c.
+extern const GrammarKeyword grammar_keywords[32];
+
+// TOKEN_ID when text is not a keyword.
+static inline TokenType grammar_keyword(const char *text, size_t length)
+{
+    if (length < 2 || length > 8)
+        return TOKEN_ID;
+    size_t slot = ((size_t)(unsigned char)text[0] * 1 + (size_t)(unsigned char)text[length - 1] * 1 + length) & 31;
+    const GrammarKeyword *keyword = &grammar_keywords[slot];
+    if (keyword->length == length && memcmp(keyword->text, text, length) == 0)
+        return keyword->type;
+    return TOKEN_ID;
+}
+// length of the longest operator text starts with, 0 when there is none.
+static inline size_t grammar_operator(const char *text, size_t length, TokenType *type)
+{
+    switch (length > 0 ? text[0] : '\0')
+    {
+    case '!':
+        switch (length > 1 ? text[1] : '\0')
+        {
+        case '=':
+            *type = TOKEN_NOT_EQUALS;
+            return 2;
+        default:
+            break;
+        }
+        *type = TOKEN_NOT;
+        return 1;
+    case '%':
+        *type = TOKEN_MOD;
+        return 1;
+    case '&':
+        switch (length > 1 ? text[1] : '\0')
+        {
+        case '&':
+            *type = TOKEN_AND;
+            return 2;
+        default:
+            break;
+        }
+        *type = TOKEN_BITWISE_AND;
+        return 1;
+    case '(':
+        *type = TOKEN_LPAREN;
+        return 1;
+    case ')':
+        *type = TOKEN_RPAREN;
+        return 1;
+    case '*':
+        *type = TOKEN_MUL;
+        return 1;
+    case '+':
+        switch (length > 1 ? text[1] : '\0')
+        {
+        case '+':
+            *type = TOKEN_INCREMENT;
+            return 2;
+        default:
+            break;
+        }
+        *type = TOKEN_PLUS;
+        return 1;
+    case ',':
+        *type = TOKEN_COMMA;
+        return 1;
+    case '-':
+        switch (length > 1 ? text[1] : '\0')
+        {
+        case '-':
+            *type = TOKEN_DECREMENT;
+            return 2;
+        default:
+            break;
+        }
+        *type = TOKEN_MINUS;
+        return 1;
+    case '/':
+        *type = TOKEN_DIV;
+        return 1;
+    case ':':
+        *type = TOKEN_COLON;
+        return 1;
+    case ';':
+        *type = TOKEN_SEMICOLON;
+        return 1;
+    case '<':
+        switch (length > 1 ? text[1] : '\0')
+        {
+        case '<':
+            *type = TOKEN_LEFT_SHIFT;
+            return 2;
+        case '=':
+            *type = TOKEN_LTE;
+            return 2;
+        default:
+            break;
+        }
+        *type = TOKEN_LT;
+        return 1;
+    case '=':
+        switch (length > 1 ? text[1] : '\0')
+        {
+        case '=':
+            *type = TOKEN_EQUALS;
+            return 2;
+        default:
+            break;
+        }
+        *type = TOKEN_ASSIGNMENT;
+        return 1;
+    case '>':
+        switch (length > 1 ? text[1] : '\0')
+        {
+        case '=':
+            *type = TOKEN_GTE;
+            return 2;
+        case '>':
+            *type = TOKEN_RIGHT_SHIFT;
+            return 2;
+        default:
+            break;
+        }
+        *type = TOKEN_GT;
+        return 1;
+    case '?':
+        *type = TOKEN_QUESTION;
+        return 1;
+    case '{':
+        *type = TOKEN_LCURLY;
+        return 1;
+    case '|':
+        switch (length > 1 ? text[1] : '\0')
+        {
+        case '|':
+            *type = TOKEN_OR;
+            return 2;
+        default:
+            break;
+        }
+        *type = TOKEN_BITWISE_OR;
+        return 1;
+    case '}':
+        *type = TOKEN_RCURLY;
+        return 1;
+    case '~':
+        *type = TOKEN_BITWISE_NOT;
+        return 1;
+    default:
+        break;
+    }
+    return 0;
+}
+#endif
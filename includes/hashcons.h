@@ -0,0 +1,19 @@
+#ifndef HASHCONS_H
+#define HASHCONS_H
+#include "AST.h"
+#include <stdint.h>
+
+typedef struct
+{
+    AST **slots;
+    size_t count;
+    size_t capacity;
+    size_t shared;
+} HashCons;
+
+HashCons *init_hashcons(void);
+uint64_t hashcons_hash(AST *ast);
+AST *hashcons_intern(HashCons *table, AST *ast);
+void hashcons_clear(HashCons *table);
+void hashcons_free(HashCons *table);
+#endif
\ No newline at end of file
@@ -1,11 +1,7 @@
 #ifndef HELPER_H
 #define HELPER_H
+#include <stddef.h>
+#include <stdint.h>
 int helper_num_places(int n);
-#define UNIMPLEMENTED                                                            \
-    do                                                                           \
-    {                                                                            \
-        fprintf(stderr, "unimplementd: %s:%d at %s\n", __FILE__,__LINE__,__func__); \
-        exit(1);                                                                 \
-    }                                                                            \
-    while (0)
+uint64_t helper_hash64(const void *data, size_t length, uint64_t seed);
 #endif
\ No newline at end of file
@@ -0,0 +1,23 @@
+#ifndef JIT_H
+#define JIT_H
+#include <stddef.h>
+#include "AST.h"
+#include "eval.h"
+#include "strbuf.h"
+
+// code is NULL where no machine code could be made, and jit_call interprets expr instead.
+typedef struct
+{
+    double (*code)(const double *args);
+    void *map;
+    size_t map_size;
+    AST *expr;
+    EvalSignature signature;
+} JitFunction;
+
+// translates a numeric expression to SSE2 code on x86-64; NULL with a message in error when it is not numeric.
+// args of the result follow signature.params; expr must outlive it.
+JitFunction *jit_compile(AST *expr, StrBuf *error);
+double jit_call(const JitFunction *function, const double *args);
+void jit_free(JitFunction *function);
+#endif
@@ -0,0 +1,8 @@
+#ifndef JSON_H
+#define JSON_H
+#include <stddef.h>
+#include "strbuf.h"
+
+// appends str as a quoted JSON string, escaping quotes, backslashes and control bytes.
+void json_put_string(StrBuf *out, const char *str, size_t length);
+#endif
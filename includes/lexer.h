@@ -1,6 +1,7 @@
 #ifndef LEXER_H
 #define LEXER_H
 #include "token.h"
+#include "strbuf.h"
 #include <stddef.h>
 
 typedef struct
@@ -8,19 +9,39 @@ typedef struct
     Token token;
     char current_char;
     size_t index;
+    size_t token_index;
     size_t row;
     size_t col;
     size_t src_size;
     char *src;
     char *file_path;
+    int streaming;
+    int starved;
 } Lexer;
 
+typedef enum
+{
+    // stop at ';', '{', '}' or a statement keyword that starts a line.
+    LEXER_SYNC_STMT,
+    // stop at the ')' closing the current group, or at ';', '{' or '}'.
+    LEXER_SYNC_GROUP,
+} LexerSync;
+
 Lexer *init_lexer(char *source, char *path);
+void lexer_reset(Lexer *lexer, char *source, char *path);
+void lexer_resume(Lexer *lexer, char *source, size_t length, size_t row, size_t col);
 Token lexer_next_token(Lexer *lexer);
+Token lexer_scan_token(Lexer *lexer);
+char lexer_sync(Lexer *lexer, LexerSync mode);
 Token lexer_advance_with(Lexer *lexer, Token token);
 void lexer_skip_space(Lexer *lexer);
 void lexer_advance(Lexer *lexer);
 Token lexer_parse_id(Lexer *lexer);
 Token lexer_parse_number(Lexer *lexer);
+Token lexer_parse_operator(Lexer *lexer);
+// lexes to the end and appends the binary stream of token_stream.h to out; one LexerError line per error token
+// goes to errors when it is not NULL. returns the number of error tokens, which are kept in the stream, or
+// SIZE_MAX without writing anything when the source is 4 GiB or larger.
+size_t lexer_write_tokens(Lexer *lexer, StrBuf *out, StrBuf *errors);
 void lexer_free(Lexer *lexer);
 #endif
\ No newline at end of file
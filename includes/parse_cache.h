@@ -0,0 +1,61 @@
+#ifndef PARSE_CACHE_H
+#define PARSE_CACHE_H
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "AST.h"
+#include "arena.h"
+
+typedef struct ParseCacheEntry ParseCacheEntry;
+struct ParseCacheEntry
+{
+    const AST *ast;
+    int had_error;
+    uint64_t hash;
+    char *source;
+    size_t length;
+    size_t bytes;
+    Arena *arena;
+    atomic_size_t refs;
+    ParseCacheEntry *chain;
+    ParseCacheEntry *prev;
+    ParseCacheEntry *next;
+};
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    ParseCacheEntry **buckets;
+    size_t bucket_count;
+    size_t count;
+    size_t bytes;
+    size_t max_bytes;
+    ParseCacheEntry *newest;
+    ParseCacheEntry *oldest;
+} ParseCacheShard;
+
+typedef struct
+{
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+    size_t entries;
+    size_t bytes;
+} ParseCacheStats;
+
+typedef struct
+{
+    ParseCacheShard *shards;
+    size_t shard_count;
+    atomic_size_t hits;
+    atomic_size_t misses;
+    atomic_size_t evictions;
+} ParseCache;
+
+ParseCache *init_parse_cache(size_t max_bytes, size_t shard_count);
+const ParseCacheEntry *parse_cache_acquire(ParseCache *cache, const char *source, size_t length);
+void parse_cache_release(const ParseCacheEntry *entry);
+ParseCacheStats parse_cache_stats(ParseCache *cache);
+void parse_cache_free(ParseCache *cache);
+#endif
\ No newline at end of file
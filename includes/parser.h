@@ -3,6 +3,57 @@
 #include "token.h"
 #include "AST.h"
 #include "lexer.h"
+#include "hashcons.h"
+#include "ast_index.h"
+
+// bump whenever the emitted output for the same source changes.
+#define PARSER_VERSION "3"
+
+typedef struct
+{
+    size_t row;
+    size_t col;
+    char *message;
+} ParserDiagnostic;
+
+// receives ownership of each complete top-level decl; token.start inside it is only valid during the call.
+typedef void (*ParserDeclFn)(AST *decl, void *data);
+
+typedef struct
+{
+    StrBuf pending;
+    size_t row;
+    size_t col;
+    size_t starved_at;
+    int done;
+    ParserDeclFn on_decl;
+    void *data;
+} ParserStream;
+
+// zero means unlimited; bytes counts nodes, names and child slots as the parser creates them.
+typedef struct
+{
+    size_t max_depth;
+    size_t max_nodes;
+    size_t max_bytes;
+    size_t max_diagnostics;
+    size_t max_steps;
+    size_t max_millis;
+} ParserLimits;
+
+typedef enum
+{
+    PARSER_LIMIT_NONE,
+    PARSER_LIMIT_DEPTH,
+    PARSER_LIMIT_NODES,
+    PARSER_LIMIT_BYTES,
+    PARSER_LIMIT_DIAGNOSTICS,
+    PARSER_LIMIT_STEPS,
+    PARSER_LIMIT_TIME,
+} ParserLimit;
+
+// diagnostics past this many are counted in had_error but not kept.
+#define PARSER_MAX_DIAGNOSTICS 256
 
 typedef struct
 {
@@ -11,29 +62,35 @@ typedef struct
     int panic_mode;
     int parsing_call;
     Lexer *lexer;
+    HashCons *hashcons;
+    ParserStream *stream;
+    ASTIndex *index;
+    ParserLimits limits;
+    ParserLimit limit;
+    size_t depth;
+    size_t nodes;
+    size_t bytes;
+    size_t steps;
+    // errors reported so far, kept or not; max_diagnostics is checked against it.
+    size_t errors;
+    size_t error_row;
+    size_t error_col;
+    // where the expression interned last starts; a shared node keeps the position of its first occurrence.
+    size_t left_row;
+    size_t left_col;
+    double deadline;
+    define_array(diagnostics, ParserDiagnostic);
 } Parser;
 
-typedef enum
-{
-    PREC_NONE,
-    PREC_COMMA,       // ,
-    PREC_ASSIGNMENT,  // =
-    PREC_TERNARY,     // ?:
-    PREC_LOGICAL_OR,  // ||
-    PREC_LOGICAL_AND, // &&
-    PREC_BITWISE_OR,  // |
-    PREC_BITWISE_XOR, // ^
-    PREC_BITWISE_AND, // &
-    PREC_EQUALITY,    // == !=
-    PREC_COMPARISON,  // < > <= >=
-    PREC_SHIFT,       // >> <<
-    PREC_TERM,        // + -
-    PREC_FACTOR,      // * / *
-    PREC_UNARY,       // ! - ++ --
-    PREC_POSTIFX,     // . () ++ -- []
-} Precedence;
 char *parser_prec_to_str(Precedence prec);
 Parser *init_parser(Lexer *lexer);
+void parser_reset(Parser *parser, Lexer *lexer);
+void parser_enable_hashcons(Parser *parser);
+void parser_enable_index(Parser *parser);
+void parser_set_limits(Parser *parser, ParserLimits limits);
+void parser_stream(Parser *parser, ParserDeclFn on_decl, void *data);
+size_t parser_feed(Parser *parser, const char *chunk, size_t length);
+size_t parser_finish(Parser *parser);
 Token parser_advance(Parser *parser);
 AST *parser_parse(Parser *parser);
 AST *parser_parse_decl(Parser *parser);
@@ -50,8 +107,15 @@ AST *parser_parse_postfix(Parser *parser, AST *operand);
 AST *parser_parse_call(Parser *parser, AST *callee);
 AST *parser_parse_comma(Parser *parser, AST *prefix);
 AST *parser_parse_compound(Parser *parser);
+AST *parser_parse_unsupported(Parser *parser);
 void parser_state(Parser *parser);
-void parser_error(Parser *parser, char *message);
+void parser_error(Parser *parser, const char *message);
+void parser_error_unexpected(Parser *parser, char *message);
+void parser_token_error(Parser *parser, Token token, const char *message);
+void parser_print_diagnostics(Parser *parser);
+void parser_clear_diagnostics(Parser *parser);
+AST *parser_parse_no_prefix(Parser *parser);
+AST *parser_parse_no_infix(Parser *parser, AST *prefix);
 typedef AST *(*ParsePrefixFn)(Parser *parser);
 typedef AST *(*ParseInfixFn)(Parser *parser, AST *prefix);
 typedef struct
@@ -59,6 +123,8 @@ typedef struct
     ParsePrefixFn prefix;
     ParseInfixFn infix;
     Precedence precedence;
+    Associativity associativity;
 } ParseRule;
+
 void parser_free(Parser *parser);
 #endif
\ No newline at end of file
@@ -0,0 +1,42 @@
+#ifndef PRATT_H
+#define PRATT_H
+#include <stddef.h>
+#include "AST.h"
+#include "parser.h"
+#include "ast_snapshot.h"
+
+#define PRATT_OK 0
+#define PRATT_ERROR_SYNTAX 1
+#define PRATT_ERROR_INVALID_ARGUMENT 2
+#define PRATT_ERROR_LIMIT_DEPTH 3
+#define PRATT_ERROR_LIMIT_NODES 4
+#define PRATT_ERROR_LIMIT_BYTES 5
+#define PRATT_ERROR_LIMIT_DIAGNOSTICS 6
+#define PRATT_ERROR_LIMIT_STEPS 7
+#define PRATT_ERROR_LIMIT_TIME 8
+
+typedef ParserDiagnostic pratt_diagnostic;
+
+typedef struct
+{
+    const char *file_path;
+    int hashcons;
+    int index;
+    ParserLimits limits;
+} pratt_options;
+
+typedef struct
+{
+    int status;
+    AST *ast;
+    pratt_diagnostic *diagnostics;
+    size_t diagnostic_count;
+    Arena *arena;
+    ASTIndex *index;
+} pratt_result;
+
+int pratt_parse(const char *buf, size_t len, const pratt_options *options, pratt_result *result);
+// moves the tree, its arena and its index out of result; NULL when the parse failed.
+const ASTSnapshot *pratt_result_freeze(pratt_result *result);
+void pratt_result_free(pratt_result *result);
+#endif
\ No newline at end of file
@@ -0,0 +1,58 @@
+#ifndef READER_H
+#define READER_H
+#include <stddef.h>
+#include <pthread.h>
+
+#define READER_DEFAULT_DEPTH 32
+
+typedef enum
+{
+    READER_AUTO,
+    READER_URING,
+    READER_POOL,
+} ReaderBackend;
+
+// a whole file, NUL-terminated; data is NULL and error holds an errno when it could not be read.
+typedef struct
+{
+    char *path;
+    char *data;
+    size_t length;
+    int error;
+} ReaderFile;
+
+typedef struct ReaderSlot ReaderSlot;
+typedef struct ReaderRing ReaderRing;
+
+// reads many files ahead of their consumer, at most depth at a time, and hands them out as they complete.
+typedef struct
+{
+    char **paths;
+    size_t count;
+    size_t depth;
+    size_t next;
+    size_t delivered;
+    ReaderBackend backend;
+    ReaderRing *ring;
+    ReaderSlot *slots;
+    size_t in_flight;
+    pthread_t *threads;
+    size_t thread_count;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    pthread_cond_t space;
+    ReaderFile *done;
+    size_t done_head;
+    size_t done_count;
+    size_t claimed;
+} Reader;
+
+// depth 0 picks READER_DEFAULT_DEPTH; READER_AUTO uses io_uring where the kernel allows it and a pread pool otherwise.
+Reader *init_reader(char **paths, size_t count, size_t depth, ReaderBackend backend);
+// blocks until the next file is ready; 0 once every file has been handed out. The caller frees file->data.
+int reader_next(Reader *reader, ReaderFile *file);
+void reader_free(Reader *reader);
+// expands directories into the regular files below them; the list and its strings are the caller's.
+char **reader_list(char **paths, size_t count, size_t *out_count);
+void reader_list_free(char **paths, size_t count);
+#endif
@@ -0,0 +1,32 @@
+#ifndef SERVE_H
+#define SERVE_H
+#include <stdint.h>
+#include "AST.h"
+#include "parser.h"
+
+// request: u32 big-endian payload length, u8 format, payload.
+// response: u32 big-endian payload length, u8 status, payload.
+#define SERVE_HEADER_SIZE 5
+#define SERVE_MAX_REQUEST (64u * 1024u * 1024u)
+// a client that leaves a response unread this long is dropped, so it cannot hold a worker.
+#define SERVE_WRITE_TIMEOUT_MS 5000
+
+#define SERVE_FORMAT_JSON 0
+#define SERVE_FORMAT_CBOR 1
+
+#define SERVE_STATUS_OK 0
+#define SERVE_STATUS_PARSE_ERROR 1
+#define SERVE_STATUS_BAD_REQUEST 2
+#define SERVE_STATUS_LIMIT 3
+
+typedef struct
+{
+    int workers;
+    int hashcons;
+    AST_JsonOptions json;
+    AST_CborOptions cbor;
+    ParserLimits limits;
+} ServeOptions;
+
+int serve_run(const char *socket_path, ServeOptions *options);
+#endif
\ No newline at end of file
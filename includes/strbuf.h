@@ -0,0 +1,21 @@
+#ifndef STRBUF_H
+#define STRBUF_H
+#include <stddef.h>
+
+typedef struct
+{
+    char *data;
+    size_t length;
+    size_t capacity;
+} StrBuf;
+
+StrBuf init_strbuf(void);
+void strbuf_reserve(StrBuf *buf, size_t extra);
+void strbuf_append(StrBuf *buf, const char *data, size_t length);
+void strbuf_puts(StrBuf *buf, const char *str);
+void strbuf_putc(StrBuf *buf, char c);
+void strbuf_printf(StrBuf *buf, const char *format, ...);
+void strbuf_reset(StrBuf *buf);
+char *strbuf_detach(StrBuf *buf);
+void strbuf_free(StrBuf *buf);
+#endif
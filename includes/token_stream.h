@@ -0,0 +1,83 @@
+#ifndef TOKEN_STREAM_H
+#define TOKEN_STREAM_H
+// reader for the binary token stream written by --tokens; it needs nothing else from the parser.
+// layout, in the writer's byte order (little-endian on every supported target):
+//   TokenStreamHeader, token_count TokenRecords, line_count uint32 line start offsets.
+// every part is 4-byte aligned, so a mapped or read file can be used in place.
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define TOKEN_STREAM_MAGIC "PTOK"
+#define TOKEN_STREAM_VERSION 1
+
+typedef struct
+{
+    char magic[4];
+    uint32_t version;
+    // number of token types of the writer's grammar; the type values are its TokenType from grammar.h.
+    uint32_t type_count;
+    uint32_t token_count;
+    uint32_t line_count;
+    uint32_t source_size;
+} TokenStreamHeader;
+
+// offset and length are in bytes of the source, a string's cover its contents without the quotes; the EOF token
+// is not stored.
+typedef struct
+{
+    uint32_t offset;
+    uint32_t length;
+    uint32_t type;
+} TokenRecord;
+
+typedef struct
+{
+    const TokenStreamHeader *header;
+    const TokenRecord *tokens;
+    // lines[i] is the offset of line i + 1, lines[0] is 0.
+    const uint32_t *lines;
+    size_t token_count;
+    size_t line_count;
+} TokenStream;
+
+// 0 when data holds a whole stream of this version, -1 otherwise; data must stay alive while the stream is used.
+static inline int token_stream_open(TokenStream *stream, const void *data, size_t size)
+{
+    const TokenStreamHeader *header = (const TokenStreamHeader *)data;
+    if (data == NULL || ((uintptr_t)data & 3) != 0 || size < sizeof(TokenStreamHeader))
+        return -1;
+    if (memcmp(header->magic, TOKEN_STREAM_MAGIC, 4) != 0 || header->version != TOKEN_STREAM_VERSION)
+        return -1;
+    uint64_t needed = sizeof(TokenStreamHeader) + (uint64_t)header->token_count * sizeof(TokenRecord) +
+                      (uint64_t)header->line_count * sizeof(uint32_t);
+    if (needed > size || header->line_count == 0)
+        return -1;
+    stream->header = header;
+    stream->tokens = (const TokenRecord *)(header + 1);
+    stream->lines = (const uint32_t *)(stream->tokens + header->token_count);
+    stream->token_count = header->token_count;
+    stream->line_count = header->line_count;
+    return 0;
+}
+// 1-based line of a source offset, by binary search over the line table.
+static inline size_t token_stream_line(const TokenStream *stream, uint32_t offset)
+{
+    size_t low = 0;
+    size_t high = stream->line_count;
+    while (high - low > 1)
+    {
+        size_t middle = low + (high - low) / 2;
+        if (stream->lines[middle] <= offset)
+            low = middle;
+        else
+            high = middle;
+    }
+    return low + 1;
+}
+// 1-based byte column of a source offset on the given line.
+static inline size_t token_stream_col(const TokenStream *stream, size_t line, uint32_t offset)
+{
+    return (size_t)(offset - stream->lines[line - 1]) + 1;
+}
+#endif
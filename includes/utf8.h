@@ -0,0 +1,14 @@
+#ifndef UTF8_H
+#define UTF8_H
+#include <stddef.h>
+#include <stdint.h>
+
+// decodes one code point; 0 when the sequence is malformed, overlong, a surrogate or cut off by length.
+size_t utf8_decode(const char *str, size_t length, uint32_t *codepoint);
+// bytes a sequence starting with lead claims, 0 for a byte that cannot start one.
+size_t utf8_sequence_length(char lead);
+// 1 when all of str is well-formed UTF-8.
+int utf8_valid(const char *str, size_t length);
+int utf8_is_id_start(uint32_t codepoint);
+int utf8_is_id_continue(uint32_t codepoint);
+#endif
@@ -0,0 +1,417 @@
+#define _DEFAULT_SOURCE
+#include "jit.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) && !defined(_WIN32)
+#include <sys/mman.h>
+#include <unistd.h>
+#define JIT_X86_64
+#endif
+
+#ifdef JIT_X86_64
+// System V: args arrives in rdi and is kept in rbx, every value lives in xmm0 and operands wait in stack slots.
+#define JIT_XMM0 0
+#define JIT_XMM1 1
+#define JIT_XMM2 2
+#define JIT_BASE_RBX 3
+#define JIT_BASE_RSP 4
+#define JIT_ONE 0x3FF0000000000000ull
+#define JIT_SIGN 0x8000000000000000ull
+
+typedef struct
+{
+    StrBuf code;
+    const EvalSignature *signature;
+    int writes;
+    size_t depth;
+    size_t max_depth;
+} JitWriter;
+
+// the bitwise operators share eval_int's saturation, so they are calls rather than cvttsd2si.
+static double jit_bit_and(double left, double right)
+{
+    return (double)(eval_int(left) & eval_int(right));
+}
+static double jit_bit_or(double left, double right)
+{
+    return (double)(eval_int(left) | eval_int(right));
+}
+static double jit_shl(double left, double right)
+{
+    return (double)(int64_t)((uint64_t)eval_int(left) << (eval_int(right) & 63));
+}
+static double jit_shr(double left, double right)
+{
+    return (double)(eval_int(left) >> (eval_int(right) & 63));
+}
+static double jit_bit_not(double value)
+{
+    return (double)~eval_int(value);
+}
+
+static void jit_bytes(JitWriter *writer, const char *bytes, size_t length)
+{
+    strbuf_append(&writer->code, bytes, length);
+}
+static void jit_u32(JitWriter *writer, uint32_t value)
+{
+    char bytes[4];
+    for (int i = 0; i < 4; i++)
+        bytes[i] = (char)(value >> (8 * i));
+    jit_bytes(writer, bytes, 4);
+}
+static void jit_u64(JitWriter *writer, uint64_t value)
+{
+    jit_u32(writer, (uint32_t)value);
+    jit_u32(writer, (uint32_t)(value >> 32));
+}
+static void jit_patch(JitWriter *writer, size_t at, size_t target)
+{
+    uint32_t rel = (uint32_t)(target - (at + 4));
+    for (int i = 0; i < 4; i++)
+        writer->code.data[at + (size_t)i] = (char)(rel >> (8 * i));
+}
+// movsd between xmm and [rbx + disp] or [rsp + disp].
+static void jit_movsd(JitWriter *writer, int store, int xmm, int base, size_t disp)
+{
+    char bytes[] = {(char)0xF2, 0x0F, store ? 0x11 : 0x10, (char)(0x80 | xmm << 3 | base), 0x24};
+    jit_bytes(writer, bytes, base == JIT_BASE_RSP ? 5 : 4);
+    jit_u32(writer, (uint32_t)disp);
+}
+static void jit_sse(JitWriter *writer, unsigned char prefix, unsigned char opcode, int dst, int src)
+{
+    char bytes[] = {(char)prefix, 0x0F, (char)opcode, (char)(0xC0 | dst << 3 | src)};
+    jit_bytes(writer, bytes, sizeof(bytes));
+}
+static void jit_cmpsd(JitWriter *writer, int dst, int src, unsigned char predicate)
+{
+    jit_sse(writer, 0xF2, 0xC2, dst, src);
+    jit_bytes(writer, (const char *)&predicate, 1);
+}
+static void jit_const(JitWriter *writer, int xmm, uint64_t bits)
+{
+    jit_bytes(writer, "\x48\xB8", 2);
+    jit_u64(writer, bits);
+    char movq[] = {0x66, 0x48, 0x0F, 0x6E, (char)(0xC0 | xmm << 3)};
+    jit_bytes(writer, movq, sizeof(movq));
+}
+static void jit_double(JitWriter *writer, int xmm, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    jit_const(writer, xmm, bits);
+}
+static void jit_call_helper(JitWriter *writer, uint64_t address)
+{
+    jit_bytes(writer, "\x48\xB8", 2);
+    jit_u64(writer, address);
+    jit_bytes(writer, "\xFF\xD0", 2);
+}
+// turns an all-ones/all-zeros cmpsd mask in xmm0 into 1.0 or 0.0.
+static void jit_mask_to_bool(JitWriter *writer)
+{
+    jit_const(writer, JIT_XMM2, JIT_ONE);
+    jit_sse(writer, 0x66, 0x54, JIT_XMM0, JIT_XMM2);
+}
+// C truth: anything but 0 and -0 is true, NaN included; falls through when xmm0 is true.
+static size_t jit_branch_if_false(JitWriter *writer)
+{
+    jit_sse(writer, 0x66, 0x57, JIT_XMM1, JIT_XMM1);
+    jit_sse(writer, 0x66, 0x2E, JIT_XMM0, JIT_XMM1);
+    jit_bytes(writer, "\x7A\x06\x0F\x84", 4);
+    size_t at = writer->code.length;
+    jit_u32(writer, 0);
+    return at;
+}
+static size_t jit_jump(JitWriter *writer)
+{
+    jit_bytes(writer, "\xE9", 1);
+    size_t at = writer->code.length;
+    jit_u32(writer, 0);
+    return at;
+}
+static size_t jit_local(JitWriter *writer, const char *name)
+{
+    return 8 * eval_param(writer->signature, name);
+}
+static size_t jit_temp(JitWriter *writer)
+{
+    size_t locals = writer->writes ? writer->signature->param_count : 0;
+    return 8 * (locals + writer->depth);
+}
+static void jit_node(JitWriter *writer, AST *ast);
+// evaluates left then right, leaving them in xmm0 and xmm1.
+static void jit_operands(JitWriter *writer, AST *left, AST *right)
+{
+    jit_node(writer, left);
+    jit_movsd(writer, 1, JIT_XMM0, JIT_BASE_RSP, jit_temp(writer));
+    writer->depth++;
+    if (writer->depth > writer->max_depth)
+        writer->max_depth = writer->depth;
+    jit_node(writer, right);
+    writer->depth--;
+    jit_sse(writer, 0x66, 0x28, JIT_XMM1, JIT_XMM0);
+    jit_movsd(writer, 0, JIT_XMM0, JIT_BASE_RSP, jit_temp(writer));
+}
+static void jit_binary(JitWriter *writer, AST *ast)
+{
+    EvalOp op = eval_op(ast);
+    if (op == EVAL_OP_ASSIGN)
+    {
+        jit_node(writer, ast->right);
+        jit_movsd(writer, 1, JIT_XMM0, JIT_BASE_RSP, jit_local(writer, ast->left->name));
+        return;
+    }
+    if (op == EVAL_OP_AND || op == EVAL_OP_OR)
+    {
+        jit_node(writer, ast->left);
+        size_t otherwise = jit_branch_if_false(writer);
+        size_t end;
+        if (op == EVAL_OP_AND)
+        {
+            jit_node(writer, ast->right);
+            jit_sse(writer, 0x66, 0x57, JIT_XMM1, JIT_XMM1);
+            jit_cmpsd(writer, JIT_XMM0, JIT_XMM1, 4);
+            jit_mask_to_bool(writer);
+            end = jit_jump(writer);
+            jit_patch(writer, otherwise, writer->code.length);
+            jit_sse(writer, 0x66, 0x57, JIT_XMM0, JIT_XMM0);
+        }
+        else
+        {
+            jit_double(writer, JIT_XMM0, 1);
+            end = jit_jump(writer);
+            jit_patch(writer, otherwise, writer->code.length);
+            jit_node(writer, ast->right);
+            jit_sse(writer, 0x66, 0x57, JIT_XMM1, JIT_XMM1);
+            jit_cmpsd(writer, JIT_XMM0, JIT_XMM1, 4);
+            jit_mask_to_bool(writer);
+        }
+        jit_patch(writer, end, writer->code.length);
+        return;
+    }
+    jit_operands(writer, ast->left, ast->right);
+    switch (op)
+    {
+    case EVAL_OP_ADD:
+        jit_sse(writer, 0xF2, 0x58, JIT_XMM0, JIT_XMM1);
+        return;
+    case EVAL_OP_SUB:
+        jit_sse(writer, 0xF2, 0x5C, JIT_XMM0, JIT_XMM1);
+        return;
+    case EVAL_OP_MUL:
+        jit_sse(writer, 0xF2, 0x59, JIT_XMM0, JIT_XMM1);
+        return;
+    case EVAL_OP_DIV:
+        jit_sse(writer, 0xF2, 0x5E, JIT_XMM0, JIT_XMM1);
+        return;
+    case EVAL_OP_EQ:
+    case EVAL_OP_NE:
+    case EVAL_OP_LT:
+    case EVAL_OP_LE:
+        jit_cmpsd(writer, JIT_XMM0, JIT_XMM1, op == EVAL_OP_EQ ? 0 : op == EVAL_OP_NE ? 4 : op == EVAL_OP_LT ? 1 : 2);
+        jit_mask_to_bool(writer);
+        return;
+    case EVAL_OP_GT:
+    case EVAL_OP_GE:
+        jit_cmpsd(writer, JIT_XMM1, JIT_XMM0, op == EVAL_OP_GT ? 1 : 2);
+        jit_sse(writer, 0x66, 0x28, JIT_XMM0, JIT_XMM1);
+        jit_mask_to_bool(writer);
+        return;
+    case EVAL_OP_MOD:
+        jit_call_helper(writer, (uint64_t)(uintptr_t)fmod);
+        return;
+    case EVAL_OP_BIT_AND:
+        jit_call_helper(writer, (uint64_t)(uintptr_t)jit_bit_and);
+        return;
+    case EVAL_OP_BIT_OR:
+        jit_call_helper(writer, (uint64_t)(uintptr_t)jit_bit_or);
+        return;
+    case EVAL_OP_SHL:
+        jit_call_helper(writer, (uint64_t)(uintptr_t)jit_shl);
+        return;
+    default:
+        jit_call_helper(writer, (uint64_t)(uintptr_t)jit_shr);
+        return;
+    }
+}
+static void jit_node(JitWriter *writer, AST *ast)
+{
+    switch (ast->type)
+    {
+    case AST_NUMBER:
+        jit_double(writer, JIT_XMM0, ast->number);
+        return;
+    case AST_TRUE:
+    case AST_FALSE:
+    case AST_NULL:
+        jit_double(writer, JIT_XMM0, ast->type == AST_TRUE);
+        return;
+    case AST_ID:
+        jit_movsd(writer, 0, JIT_XMM0, writer->writes ? JIT_BASE_RSP : JIT_BASE_RBX, jit_local(writer, ast->name));
+        return;
+    case AST_BINARY:
+        jit_binary(writer, ast);
+        return;
+    case AST_UNARY:
+    case AST_POSTFIX:
+    {
+        EvalOp op = eval_op(ast);
+        if (op == EVAL_OP_INC || op == EVAL_OP_DEC)
+        {
+            size_t local = jit_local(writer, ast->value->name);
+            unsigned char step = op == EVAL_OP_INC ? 0x58 : 0x5C;
+            int updated = ast->type == AST_POSTFIX ? JIT_XMM2 : JIT_XMM0;
+            jit_movsd(writer, 0, JIT_XMM0, JIT_BASE_RSP, local);
+            jit_double(writer, JIT_XMM1, 1);
+            if (updated != JIT_XMM0)
+                jit_sse(writer, 0x66, 0x28, updated, JIT_XMM0);
+            jit_sse(writer, 0xF2, step, updated, JIT_XMM1);
+            jit_movsd(writer, 1, updated, JIT_BASE_RSP, local);
+            return;
+        }
+        jit_node(writer, ast->value);
+        if (op == EVAL_OP_NEG)
+        {
+            jit_const(writer, JIT_XMM1, JIT_SIGN);
+            jit_sse(writer, 0x66, 0x57, JIT_XMM0, JIT_XMM1);
+        }
+        else if (op == EVAL_OP_NOT)
+        {
+            jit_sse(writer, 0x66, 0x57, JIT_XMM1, JIT_XMM1);
+            jit_cmpsd(writer, JIT_XMM0, JIT_XMM1, 0);
+            jit_mask_to_bool(writer);
+        }
+        else
+            jit_call_helper(writer, (uint64_t)(uintptr_t)jit_bit_not);
+        return;
+    }
+    case AST_TERNARY:
+    {
+        jit_node(writer, ast->value);
+        size_t otherwise = jit_branch_if_false(writer);
+        jit_node(writer, ast->left);
+        size_t end = jit_jump(writer);
+        jit_patch(writer, otherwise, writer->code.length);
+        jit_node(writer, ast->right);
+        jit_patch(writer, end, writer->code.length);
+        return;
+    }
+    case AST_SEQUENCEEXPR:
+        for (size_t i = 0; i < array_size(&ast->childs); i++)
+            jit_node(writer, array_at(&ast->childs, i));
+        return;
+    default:
+    {
+        const EvalBuiltin *builtin = eval_builtin(ast->left->name);
+        size_t count;
+        AST **args = eval_call_args(ast, &count);
+        if (count > 1)
+        {
+            jit_operands(writer, args[0], args[1]);
+            jit_call_helper(writer, (uint64_t)(uintptr_t)builtin->binary);
+            return;
+        }
+        jit_node(writer, args[0]);
+        jit_call_helper(writer, (uint64_t)(uintptr_t)builtin->unary);
+        return;
+    }
+    }
+}
+// parameters are copied into the frame only when the expression assigns to one.
+static int jit_writes(AST *ast)
+{
+    if (ast == NULL)
+        return 0;
+    EvalOp op = eval_op(ast);
+    if ((ast->type == AST_BINARY && op == EVAL_OP_ASSIGN) || op == EVAL_OP_INC || op == EVAL_OP_DEC)
+        return 1;
+    for (size_t i = 0; i < array_size(&ast->childs); i++)
+        if (jit_writes(array_at(&ast->childs, i)))
+            return 1;
+    return jit_writes(ast->value) || jit_writes(ast->left) || jit_writes(ast->right);
+}
+// the frame size is patched in once the deepest operand stack is known; it stays a multiple of 16 for calls.
+static void jit_emit(JitWriter *writer, AST *expr)
+{
+    jit_bytes(writer, "\x53\x48\x89\xFB\x48\x81\xEC", 7);
+    size_t frame_at = writer->code.length;
+    jit_u32(writer, 0);
+    size_t locals = writer->writes ? writer->signature->param_count : 0;
+    for (size_t i = 0; i < locals; i++)
+    {
+        jit_movsd(writer, 0, JIT_XMM0, JIT_BASE_RBX, 8 * i);
+        jit_movsd(writer, 1, JIT_XMM0, JIT_BASE_RSP, 8 * i);
+    }
+    jit_node(writer, expr);
+    size_t frame = 8 * (locals + writer->max_depth);
+    frame = (frame + 15) & ~(size_t)15;
+    jit_bytes(writer, "\x48\x81\xC4", 3);
+    jit_u32(writer, (uint32_t)frame);
+    jit_bytes(writer, "\x5B\xC3", 2);
+    for (int i = 0; i < 4; i++)
+        writer->code.data[frame_at + (size_t)i] = (char)(frame >> (8 * i));
+}
+// the buffer is written while only readable and writable, then flipped to read and execute.
+static void jit_map(JitFunction *function, StrBuf *code)
+{
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t size = (code->length + page - 1) / page * page;
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED)
+        return;
+    memcpy(map, code->data, code->length);
+    if (mprotect(map, size, PROT_READ | PROT_EXEC) != 0)
+    {
+        munmap(map, size);
+        return;
+    }
+    function->map = map;
+    function->map_size = size;
+    memcpy(&function->code, &map, sizeof(map));
+}
+#endif
+
+JitFunction *jit_compile(AST *expr, StrBuf *error)
+{
+    JitFunction *function = calloc(1, sizeof(JitFunction));
+    const char *message = eval_check(expr, &function->signature);
+    if (message)
+    {
+        AST *bad = function->signature.bad;
+        if (bad && bad->token.start)
+            strbuf_printf(error, "%zu:%zu: %s", bad->token.row, bad->token.col, message);
+        else
+            strbuf_puts(error, message);
+        jit_free(function);
+        return NULL;
+    }
+    function->expr = expr;
+#ifdef JIT_X86_64
+    JitWriter writer = {init_strbuf(), &function->signature, jit_writes(expr), 0, 0};
+    jit_emit(&writer, expr);
+    jit_map(function, &writer.code);
+    strbuf_free(&writer.code);
+#endif
+    return function;
+}
+double jit_call(const JitFunction *function, const double *args)
+{
+    if (function->code)
+        return function->code(args);
+    return eval_ast(function->expr, &function->signature, args);
+}
+void jit_free(JitFunction *function)
+{
+    if (function == NULL)
+        return;
+#ifdef JIT_X86_64
+    if (function->map)
+        munmap(function->map, function->map_size);
+#endif
+    eval_signature_free(&function->signature);
+    free(function);
+}
@@ -0,0 +1,100 @@
+#include "json.h"
+
+#if defined(JSON_SCALAR)
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define JSON_AVX2
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define JSON_SSE2
+#endif
+
+static const char json_hex[] = "0123456789abcdef";
+
+static int json_needs_escape(unsigned char c)
+{
+    return c < 0x20 || c == '"' || c == '\\';
+}
+static void json_put_escape(StrBuf *out, unsigned char c)
+{
+    switch (c)
+    {
+    case '"':
+        strbuf_append(out, "\\\"", 2);
+        return;
+    case '\\':
+        strbuf_append(out, "\\\\", 2);
+        return;
+    case '\b':
+        strbuf_append(out, "\\b", 2);
+        return;
+    case '\f':
+        strbuf_append(out, "\\f", 2);
+        return;
+    case '\n':
+        strbuf_append(out, "\\n", 2);
+        return;
+    case '\r':
+        strbuf_append(out, "\\r", 2);
+        return;
+    case '\t':
+        strbuf_append(out, "\\t", 2);
+        return;
+    default:
+    {
+        char unicode[6] = {'\\', 'u', '0', '0', json_hex[c >> 4], json_hex[c & 0xF]};
+        strbuf_append(out, unicode, sizeof(unicode));
+    }
+    }
+}
+// index of the first byte at or after i that needs escaping, or length when there is none.
+static size_t json_scan(const unsigned char *str, size_t i, size_t length)
+{
+#if defined(JSON_AVX2)
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control = _mm256_set1_epi8(0x1F);
+    for (; i + 32 <= length; i += 32)
+    {
+        __m256i block = _mm256_loadu_si256((const __m256i *)(str + i));
+        __m256i hits = _mm256_or_si256(_mm256_cmpeq_epi8(block, quote), _mm256_cmpeq_epi8(block, backslash));
+        hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(_mm256_max_epu8(block, control), control));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(hits);
+        if (mask)
+            return i + (size_t)__builtin_ctz(mask);
+    }
+#elif defined(JSON_SSE2)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+    for (; i + 16 <= length; i += 16)
+    {
+        __m128i block = _mm_loadu_si128((const __m128i *)(str + i));
+        __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, backslash));
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(_mm_max_epu8(block, control), control));
+        unsigned mask = (unsigned)_mm_movemask_epi8(hits);
+        if (mask)
+            return i + (size_t)__builtin_ctz(mask);
+    }
+#endif
+    while (i < length && !json_needs_escape(str[i]))
+        i++;
+    return i;
+}
+void json_put_string(StrBuf *out, const char *str, size_t length)
+{
+    const unsigned char *bytes = (const unsigned char *)str;
+    strbuf_reserve(out, length + 2);
+    strbuf_putc(out, '"');
+    size_t run = 0;
+    for (;;)
+    {
+        size_t i = json_scan(bytes, run, length);
+        strbuf_append(out, str + run, i - run);
+        if (i == length)
+            break;
+        json_put_escape(out, bytes[i]);
+        run = i + 1;
+    }
+    strbuf_putc(out, '"');
+}
@@ -1,9 +1,16 @@
 #include "lexer.h"
+#include "utf8.h"
 #include <ctype.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+
+#if defined(__SSE2__) && !defined(LEXER_SCALAR)
+#include <emmintrin.h>
+#define LEXER_SSE2
+#endif
 #define MIN(a, b) \
     a < b ? a : b
 
@@ -12,7 +19,7 @@ Token lexer_parse_number(Lexer *lexer)
     size_t start = lexer->index;
     size_t col = lexer->col;
 
-    while (isdigit(lexer->current_char) || lexer->current_char == '.')
+    while (isdigit((unsigned char)lexer->current_char) || lexer->current_char == '.')
     {
         lexer_advance(lexer);
     }
@@ -21,73 +28,26 @@ Token lexer_parse_number(Lexer *lexer)
                              lexer->row, col);
     return token;
 }
-TokenType lexer_check_keyword(Lexer *lexer, size_t length,
-                              const char *rest, TokenType type)
-{
-    if (memcmp(&lexer->src[lexer->index - length], rest, length) == 0)
-    {
-        return type;
-    }
-
-    return TOKEN_ID;
-}
 Token lexer_parse_id(Lexer *lexer)
 {
     size_t start = lexer->index;
     size_t col = lexer->col;
-    while (isalpha(lexer->current_char) || lexer->current_char == '_' || isdigit(lexer->current_char))
-    {
-        lexer_advance(lexer);
-    }
-    TokenType token_type = TOKEN_ID;
-    switch (lexer->src[start])
+    for (;;)
     {
-    case 'e':
-        token_type = lexer_check_keyword(lexer, 3, "lse", TOKEN_ELSE);
-        break;
-    case 'i':
-        token_type = lexer_check_keyword(lexer, 1, "f", TOKEN_IF);
-        break;
-    case 'p':
-        token_type = lexer_check_keyword(lexer, 4, "rint", TOKEN_PRINT);
-        break;
-    case 'r':
-        token_type = lexer_check_keyword(lexer, 5, "eturn", TOKEN_RETURN);
-        break;
-    case 'v':
-        token_type = lexer_check_keyword(lexer, 2, "ar", TOKEN_VAR);
-        break;
-    case 'w':
-        token_type = lexer_check_keyword(lexer, 4, "hile", TOKEN_WHILE);
-        break;
-    case 't':
-        token_type = lexer_check_keyword(lexer, 3, "rue", TOKEN_TRUE);
-        break;
-    case 'n':
-        token_type = lexer_check_keyword(lexer, 3, "ull", TOKEN_NULL);
-        break;
-    case 'f':
-        if (&lexer->src[lexer->index] - lexer->src > 1)
+        unsigned char c = (unsigned char)lexer->current_char;
+        if (isalnum(c) || c == '_')
         {
-            switch (lexer->src[start + 1])
-            {
-            case 'o':
-                token_type = lexer_check_keyword(lexer, 1, "r", TOKEN_FOR);
-                break;
-            case 'u':
-                token_type = lexer_check_keyword(lexer, 7, "unction", TOKEN_FUNCTION);
-                break;
-            case 'a':
-                token_type = lexer_check_keyword(lexer, 4, "alse", TOKEN_FALSE);
-                break;
-            default:
-                break;
-            }
+            lexer_advance(lexer);
+            continue;
         }
-
-    default:
-        break;
+        uint32_t codepoint;
+        size_t n = c >= 0x80 ? utf8_decode(&lexer->src[lexer->index], lexer->src_size - lexer->index, &codepoint) : 0;
+        if (n == 0 || !utf8_is_id_continue(codepoint))
+            break;
+        while (n--)
+            lexer_advance(lexer);
     }
+    TokenType token_type = grammar_keyword(&lexer->src[start], lexer->index - start);
     Token token = init_token(&lexer->src[start], token_type, lexer->index - start,
                              lexer->row, col);
     return token;
@@ -115,11 +75,89 @@ void lexer_advance(Lexer *lexer)
         lexer->current_char = '\0';
     }
 }
+char lexer_peek(Lexer *lexer, size_t offset)
+{
+    return lexer->src[MIN(lexer->index + offset, lexer->src_size)];
+}
+// index just past the "*/" closing a block comment whose body starts at i, or SIZE_MAX when it is unterminated;
+// a "*/" ending the input also ends at length.
+// also counts the newlines crossed and where the line after the last one starts.
+static size_t lexer_find_comment_end(const char *src, size_t i, size_t length, size_t *rows, size_t *line_start)
+{
+#ifdef LEXER_SSE2
+    const __m128i star = _mm_set1_epi8('*');
+    const __m128i slash = _mm_set1_epi8('/');
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; i + 17 <= length; i += 16)
+    {
+        __m128i block = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i next = _mm_loadu_si128((const __m128i *)(src + i + 1));
+        unsigned ends = (unsigned)_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(block, star), _mm_cmpeq_epi8(next, slash)));
+        unsigned lines = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline));
+        if (ends)
+            lines &= (ends & -ends) - 1;
+        if (lines)
+        {
+            *rows += (size_t)__builtin_popcount(lines);
+            *line_start = i + (size_t)(31 - __builtin_clz(lines)) + 1;
+        }
+        if (ends)
+            return i + (size_t)__builtin_ctz(ends) + 2;
+    }
+#endif
+    for (; i < length; i++)
+    {
+        if (src[i] == '*' && i + 1 < length && src[i + 1] == '/')
+            return i + 2;
+        if (src[i] == '\n')
+        {
+            (*rows)++;
+            *line_start = i + 1;
+        }
+    }
+    return SIZE_MAX;
+}
+// 0 when the block comment at the lexer never ends, which lexer_parse_operator reports; a streamed one may still end.
+static int lexer_skip_block_comment(Lexer *lexer)
+{
+    size_t rows = 0;
+    size_t line_start = 0;
+    size_t end = lexer_find_comment_end(lexer->src, lexer->index + 2, lexer->src_size, &rows, &line_start);
+    if (end == SIZE_MAX)
+    {
+        if (!lexer->streaming)
+            return 0;
+        end = lexer->src_size;
+    }
+    lexer->row += rows;
+    lexer->col = rows ? end - line_start + 1 : lexer->col + (end - lexer->index);
+    lexer->index = end;
+    lexer->current_char = lexer->src[end];
+    return 1;
+}
+// the newline is left in place so lexer_advance counts the row.
+static void lexer_skip_line_comment(Lexer *lexer)
+{
+    const char *newline = memchr(lexer->src + lexer->index, '\n', lexer->src_size - lexer->index);
+    size_t end = newline ? (size_t)(newline - lexer->src) : lexer->src_size;
+    lexer->col += end - lexer->index;
+    lexer->index = end;
+    lexer->current_char = lexer->src[end];
+}
 void lexer_skip_space(Lexer *lexer)
 {
-    while (isspace(lexer->current_char))
+    for (;;)
     {
-        lexer_advance(lexer);
+        while (isspace((unsigned char)lexer->current_char))
+            lexer_advance(lexer);
+        if (lexer->current_char != '/')
+            return;
+        char next = lexer_peek(lexer, 1);
+        if (next == '/')
+            lexer_skip_line_comment(lexer);
+        else if (next != '*' || !lexer_skip_block_comment(lexer))
+            return;
     }
 }
 Token lexer_advance_with(Lexer *lexer, Token token)
@@ -139,30 +177,84 @@ Token lexer_parse_string(Lexer *lexer)
         if (lexer->current_char == '\n' || lexer->current_char == '\0')
             break;
     }
-    if (lexer->current_char == '"')
+    if (lexer->current_char == '"' && utf8_valid(&lexer->src[start], lexer->index - start))
     {
         return lexer_advance_with(lexer, init_token(&lexer->src[start], TOKEN_STRING, lexer->index - start, row, col));
     }
+    if (lexer->current_char == '"')
+    {
+        Token string = init_token(&lexer->src[start - 1], TOKEN_ERROR, 1, row, col);
+        lexer_advance(lexer);
+        string.message = "invalid UTF-8 in string";
+        return string;
+    }
 
     Token string = init_token(&lexer->src[start - 1], TOKEN_ERROR, 1, row, col);
     lexer_advance(lexer);
     string.message = "non-terminated string";
     return string;
 }
-char lexer_peek(Lexer *lexer, size_t offset)
+// a non-ASCII byte starts an identifier, or is an error covering the whole character.
+static Token lexer_parse_utf8(Lexer *lexer)
 {
-    return lexer->src[MIN(lexer->index + offset, lexer->src_size)];
+    uint32_t codepoint;
+    size_t remaining = lexer->src_size - lexer->index;
+    size_t n = utf8_decode(&lexer->src[lexer->index], remaining, &codepoint);
+    if (n && utf8_is_id_start(codepoint))
+        return lexer_parse_id(lexer);
+    Token error = init_token(&lexer->src[lexer->index], TOKEN_ERROR, n ? n : 1, lexer->row, lexer->col);
+    if (n == 0)
+    {
+        error.message = "invalid UTF-8";
+        // a character cut off by the end of a streamed chunk is completed by the next one.
+        if (lexer->streaming && utf8_sequence_length(lexer->current_char) > remaining)
+        {
+            lexer->index = lexer->src_size;
+            lexer->current_char = '\0';
+            return error;
+        }
+    }
+    for (size_t i = 0; i < error.length; i++)
+        lexer_advance(lexer);
+    return error;
 }
-Token lexer_next_token(Lexer *lexer)
+// the longest operator at the lexer, or a one byte TOKEN_ERROR when no operator starts there.
+Token lexer_parse_operator(Lexer *lexer)
+{
+    // lexer_skip_space already skipped every comment that ends.
+    if (lexer->current_char == '/' && lexer_peek(lexer, 1) == '*')
+    {
+        Token error = init_token(&lexer->src[lexer->index], TOKEN_ERROR, 2, lexer->row, lexer->col);
+        error.message = "non-terminated comment";
+        lexer->index = lexer->src_size;
+        lexer->current_char = '\0';
+        return error;
+    }
+    TokenType type;
+    size_t length = grammar_operator(&lexer->src[lexer->index], lexer->src_size - lexer->index, &type);
+    if (length == 0)
+        return lexer_advance_with(lexer, init_token(&lexer->src[lexer->index], TOKEN_ERROR,
+                                                    1, lexer->row, lexer->col));
+    // operators never span a newline, so only the column moves.
+    Token token = init_token(&lexer->src[lexer->index], type, length, lexer->row, lexer->col);
+    lexer->index += length;
+    lexer->col += length;
+    lexer->current_char = lexer->src[lexer->index];
+    return token;
+}
+// external so gcc keeps it out of lexer_next_token; inlined there the token is copied around and lexing gets ~10% slower.
+Token lexer_scan_token(Lexer *lexer)
 {
     while (lexer->current_char != '\0')
     {
         lexer_skip_space(lexer);
-        if (isalpha(lexer->current_char) || lexer->current_char == '_')
+        if (isalpha((unsigned char)lexer->current_char) || lexer->current_char == '_')
             return lexer_parse_id(lexer);
+        if ((unsigned char)lexer->current_char >= 0x80)
+            return lexer_parse_utf8(lexer);
 
         if (
-            isdigit(lexer->current_char) ||
+            isdigit((unsigned char)lexer->current_char) ||
             lexer->current_char == '_' ||
             lexer->current_char == '.')
         {
@@ -173,93 +265,170 @@ Token lexer_next_token(Lexer *lexer)
             return lexer_parse_string(lexer);
         }
 
-        switch (lexer->current_char)
+        if (lexer->current_char == '\0')
+            break;
+        return lexer_parse_operator(lexer);
+    }
+    return init_token(&lexer->src[lexer->index], TOKEN_EOF, 0,
+                      lexer->row, lexer->col);
+}
+static int lexer_is_sync_byte(char c)
+{
+    switch (c)
+    {
+    case ';':
+    case '{':
+    case '}':
+    case '(':
+    case ')':
+    case '"':
+    case '/':
+    case '\n':
+    case '\0':
+        return 1;
+    default:
+        return 0;
+    }
+}
+// index of the first byte at or after i that lexer_sync has to look at, or length when there is none.
+static size_t lexer_scan_sync(const char *src, size_t i, size_t length)
+{
+#ifdef LEXER_SSE2
+    const __m128i semicolon = _mm_set1_epi8(';');
+    const __m128i lcurly = _mm_set1_epi8('{');
+    const __m128i rcurly = _mm_set1_epi8('}');
+    const __m128i lparen = _mm_set1_epi8('(');
+    const __m128i rparen = _mm_set1_epi8(')');
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i slash = _mm_set1_epi8('/');
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= length; i += 16)
+    {
+        __m128i block = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(block, semicolon), _mm_cmpeq_epi8(block, lcurly));
+        hits = _mm_or_si128(hits, _mm_or_si128(_mm_cmpeq_epi8(block, rcurly), _mm_cmpeq_epi8(block, lparen)));
+        hits = _mm_or_si128(hits, _mm_or_si128(_mm_cmpeq_epi8(block, rparen), _mm_cmpeq_epi8(block, quote)));
+        hits = _mm_or_si128(hits, _mm_or_si128(_mm_cmpeq_epi8(block, newline), _mm_cmpeq_epi8(block, zero)));
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, slash));
+        unsigned mask = (unsigned)_mm_movemask_epi8(hits);
+        if (mask)
+            return i + (size_t)__builtin_ctz(mask);
+    }
+#endif
+    while (i < length && !lexer_is_sync_byte(src[i]))
+        i++;
+    return i;
+}
+// a keyword cut off by the end of the buffer does not count, a streamed chunk may continue it.
+static int lexer_is_stmt_keyword(const char *src, size_t i, size_t length)
+{
+    for (size_t k = 0; k < GRAMMAR_STMT_KEYWORD_COUNT; k++)
+    {
+        size_t n = strlen(grammar_stmt_keywords[k]);
+        unsigned char next = i + n < length ? (unsigned char)src[i + n] : 0;
+        if (i + n < length && memcmp(src + i, grammar_stmt_keywords[k], n) == 0 && !isalnum(next) && next != '_' && next < 0x80)
+            return 1;
+    }
+    return 0;
+}
+// skips raw bytes after an error without tokenizing them and leaves the lexer on the stop byte.
+char lexer_sync(Lexer *lexer, LexerSync mode)
+{
+    const char *src = lexer->src;
+    size_t length = lexer->src_size;
+    size_t i = lexer->index;
+    size_t from = i;
+    size_t row = lexer->row;
+    size_t col = lexer->col;
+    size_t depth = 0;
+    while ((i = lexer_scan_sync(src, i, length)) < length)
+    {
+        char c = src[i];
+        if (c == '\n')
         {
-        case '+':
-            if (lexer_peek(lexer, 1) == '+')
+            row++;
+            col = 1;
+            from = ++i;
+            while (i < length && src[i] != '\n' && isspace((unsigned char)src[i]))
+                i++;
+            if (mode == LEXER_SYNC_STMT && lexer_is_stmt_keyword(src, i, length))
+                break;
+        }
+        else if (c == '"')
+        {
+            // strings end at their line, like in lexer_parse_string.
+            i++;
+            while (i < length && src[i] != '"' && src[i] != '\n' && src[i] != '\0')
+                i++;
+            if (i < length && src[i] == '"')
+                i++;
+        }
+        else if (c == '/')
+        {
+            // a ';' or '}' inside a comment is not a stop.
+            char next = i + 1 < length ? src[i + 1] : '\0';
+            if (next == '/')
             {
-                return lexer_advance_with(lexer, lexer_advance_with(lexer, init_token(&lexer->src[lexer->index], TOKEN_INCREMENT, 2, lexer->row, lexer->col)));
+                const char *newline = memchr(src + i, '\n', length - i);
+                i = newline ? (size_t)(newline - src) : length;
             }
-            return lexer_advance_with(lexer, init_token(&lexer->src[lexer->index], TOKEN_PLUS, 1,
-                                                        lexer->row, lexer->col));
-        case '-':
-            if (lexer_peek(lexer, 1) == '-')
+            else if (next == '*')
             {
-                return lexer_advance_with(lexer, lexer_advance_with(lexer, init_token(&lexer->src[lexer->index], TOKEN_DECREMENT, 2, lexer->row, lexer->col)));
+                size_t rows = 0;
+                size_t line_start = 0;
+                i = lexer_find_comment_end(src, i + 2, length, &rows, &line_start);
+                if (i == SIZE_MAX)
+                    i = length;
+                row += rows;
+                if (rows)
+                {
+                    col = 1;
+                    from = line_start;
+                }
             }
-            return lexer_advance_with(lexer, init_token(&lexer->src[lexer->index], TOKEN_MINUS, 1,
-                                                        lexer->row, lexer->col));
-        case '*':
-            return lexer_advance_with(lexer, init_token(&lexer->src[lexer->index], TOKEN_MUL, 1,
-                                                        lexer->row, lexer->col));
-        case '/':
-            return lexer_advance_with(lexer, init_token(&lexer->src[lexer->index], TOKEN_DIV, 1,
-                                                        lexer->row, lexer->col));
-        case ';':
-            return lexer_advance_with(lexer, init_token(&lexer->src[lexer->index], TOKEN_SEMICOLON, 1,
-                                                        lexer->row, lexer->col));
-        case '(':
-            return lexer_advance_with(lexer,
-                                      init_token(&lexer->src[lexer->index], TOKEN_LPAREN, 1,
-                                                 lexer->row, lexer->col));
-        case ')':
-            return lexer_advance_with(lexer, init_token(&lexer->src[lexer->index], TOKEN_RPAREN, 1,
-                                                        lexer->row, lexer->col));
-        case ',':
-            return lexer_advance_with(lexer, init_token(&lexer->src[lexer->index], TOKEN_COMMA, 1, lexer->row, lexer->col));
-        case '?':
-            return lexer_advance_with(lexer, init_token(&lexer->src[lexer->index], TOKEN_QUESTION, 1, lexer->row, lexer->col));
-        case ':':
-            return lexer_advance_with(lexer, init_token(&lexer->src[lexer->index], TOKEN_COLON, 1, lexer->row, lexer->col));
-        case '=':
-            if (lexer_peek(lexer, 1) == '=')
-                return lexer_advance_with(lexer, lexer_advance_with(lexer, init_token(&lexer->src[lexer->index], TOKEN_EQUALS, 2, lexer->row, lexer->col)));
-            return lexer_advance_with(lexer, init_token(&lexer->src[lexer->index], TOKEN_ASSIGNMENT, 1, lexer->row, lexer->col));
-        case '!':
-            if (lexer_peek(lexer, 1) == '=')
-                return lexer_advance_with(lexer, lexer_advance_with(lexer, init_token(&lexer->src[lexer->index], TOKEN_NOT_EQUALS, 2, lexer->row, lexer->col)));
-            return lexer_advance_with(lexer, init_token(&lexer->src[lexer->index], TOKEN_NOT, 1, lexer->row, lexer->col));
-        case '%':
-            return lexer_advance_with(lexer, init_token(&lexer->src[lexer->index], TOKEN_MOD, 1, lexer->row, lexer->col));
-        case '<':
-            if (lexer_peek(lexer, 1) == '<')
-                return lexer_advance_with(lexer, lexer_advance_with(lexer, init_token(&lexer->src[lexer->index], TOKEN_LEFT_SHIFT, 2, lexer->row, lexer->col)));
-            if (lexer_peek(lexer, 1) == '=')
-                return lexer_advance_with(lexer, lexer_advance_with(lexer, init_token(&lexer->src[lexer->index], TOKEN_LTE, 2, lexer->row, lexer->col)));
-            return lexer_advance_with(lexer, init_token(&lexer->src[lexer->index], TOKEN_LT, 1, lexer->row, lexer->col));
-        case '>':
-            if (lexer_peek(lexer, 1) == '>')
-                return lexer_advance_with(lexer, lexer_advance_with(lexer, init_token(&lexer->src[lexer->index], TOKEN_RIGHT_SHIFT, 2, lexer->row, lexer->col)));
-            if (lexer_peek(lexer, 1) == '=')
-                return lexer_advance_with(lexer, lexer_advance_with(lexer, init_token(&lexer->src[lexer->index], TOKEN_GTE, 2, lexer->row, lexer->col)));
-            return lexer_advance_with(lexer, init_token(&lexer->src[lexer->index], TOKEN_GT, 1, lexer->row, lexer->col));
-        case '&':
-            if (lexer_peek(lexer, 1) == '&')
-                return lexer_advance_with(lexer, lexer_advance_with(lexer, init_token(&lexer->src[lexer->index], TOKEN_AND, 2, lexer->row, lexer->col)));
-            return lexer_advance_with(lexer, init_token(&lexer->src[lexer->index], TOKEN_BITWISE_AND, 1, lexer->row, lexer->col));
-        case '|':
-            if (lexer_peek(lexer, 1) == '|')
-                return lexer_advance_with(lexer, lexer_advance_with(lexer, init_token(&lexer->src[lexer->index], TOKEN_OR, 2, lexer->row, lexer->col)));
-            return lexer_advance_with(lexer, init_token(&lexer->src[lexer->index], TOKEN_BITWISE_OR, 1, lexer->row, lexer->col));
-        case '~':
-            return lexer_advance_with(lexer, init_token(&lexer->src[lexer->index], TOKEN_BITWISE_NOT, 1, lexer->row, lexer->col));
-        case '{':
-            return lexer_advance_with(lexer, init_token(&lexer->src[lexer->index], TOKEN_LCURLY, 1, lexer->row, lexer->col));
-        case '}':
-            return lexer_advance_with(lexer, init_token(&lexer->src[lexer->index], TOKEN_RCURLY, 1, lexer->row, lexer->col));
-        case '\0':
-            break;
-        default:
-            return lexer_advance_with(lexer, init_token(&lexer->src[lexer->index], TOKEN_ERROR,
-                                                        1, lexer->row, lexer->col));
+            else
+                i++;
         }
+        else if (c == '(')
+        {
+            depth++;
+            i++;
+        }
+        else if (c == ')')
+        {
+            if (mode == LEXER_SYNC_GROUP && depth == 0)
+                break;
+            depth -= depth > 0;
+            i++;
+        }
+        else
+            break;
     }
-    return init_token(&lexer->src[lexer->index], TOKEN_EOF, 0,
-                      lexer->row, lexer->col);
+    lexer->index = i;
+    lexer->row = row;
+    lexer->col = col + (i - from);
+    lexer->current_char = i < length ? src[i] : '\0';
+    return lexer->current_char;
+}
+Token lexer_next_token(Lexer *lexer)
+{
+    lexer_skip_space(lexer);
+    lexer->token_index = lexer->index;
+    Token token = lexer_scan_token(lexer);
+    // a token touching the end of a partial buffer may still grow once more input arrives.
+    if (lexer->streaming && lexer->index >= lexer->src_size)
+        lexer->starved = 1;
+    return token;
 }
 Lexer *init_lexer(char *source, char *path)
 {
     Lexer *lexer = calloc(1, sizeof(Lexer));
+    lexer_reset(lexer, source, path);
+    return lexer;
+}
+void lexer_reset(Lexer *lexer, char *source, char *path)
+{
     lexer->col = 1;
     lexer->row = 1;
     lexer->index = 0;
@@ -267,7 +436,17 @@ Lexer *init_lexer(char *source, char *path)
     lexer->src_size = strlen(source);
     lexer->current_char = source[0];
     lexer->file_path = path;
-    return lexer;
+    lexer->starved = 0;
+}
+void lexer_resume(Lexer *lexer, char *source, size_t length, size_t row, size_t col)
+{
+    lexer->col = col;
+    lexer->row = row;
+    lexer->index = 0;
+    lexer->src = source;
+    lexer->src_size = length;
+    lexer->current_char = length ? source[0] : '\0';
+    lexer->starved = 0;
 }
 void lexer_free(Lexer *lexer)
 {
@@ -7,6 +7,15 @@
 #include "AST.h"
 #include "parser.h"
 #include "lexer.h"
+#include "serve.h"
+#include "cache.h"
+#include "strbuf.h"
+#include "emit.h"
+#include "json.h"
+#include "reader.h"
+#include "aot.h"
+#include "ast_diff.h"
+#include <stdint.h>
 
 static char *readFile(const char *path)
 {
@@ -14,7 +23,7 @@ static char *readFile(const char *path)
     if (file == NULL)
     {
         fprintf(stderr, "[ERROR] could not open file \"%s\".\n", path);
-        exit(1);
+        return NULL;
     }
     fseek(file, 0L, SEEK_END);
     size_t fileSize = (size_t)ftell(file);
@@ -24,7 +33,8 @@ static char *readFile(const char *path)
     if (buffer == NULL)
     {
         fprintf(stderr, "[ERROR] not enough memory to read \"%s\".\n", path);
-        exit(1);
+        fclose(file);
+        return NULL;
     }
     size_t bytesRead = fread(buffer, sizeof(char), fileSize, file);
     if (bytesRead < fileSize)
@@ -32,40 +42,422 @@ static char *readFile(const char *path)
         fprintf(stderr, "[ERROR] could not read file \"%s\".\n", path);
         fclose(file);
         free(buffer);
-        exit(0);
+        return NULL;
     }
     buffer[bytesRead] = '\0';
 
     fclose(file);
     return buffer;
 }
+typedef struct
+{
+    StrBuf out;
+    Arena *arena;
+    AST_JsonOptions *json_options;
+    AST_CborOptions *cbor_options;
+} NdjsonSink;
+
+static void ndjson_on_decl(AST *decl, void *data)
+{
+    NdjsonSink *sink = data;
+    strbuf_reset(&sink->out);
+    if (sink->cbor_options)
+        ast_write_cbor(&sink->out, decl, sink->cbor_options);
+    else
+    {
+        ast_write_json(&sink->out, decl, sink->json_options);
+        strbuf_putc(&sink->out, '\n');
+    }
+    fwrite(sink->out.data, 1, sink->out.length, stdout);
+    arena_reset(sink->arena);
+}
+// prints every top-level decl as its own line as soon as it is parsed, so memory stays flat.
+static int parse_ndjson(char *path, AST_JsonOptions *json_options, AST_CborOptions *cbor_options,
+                        ParserLimits *limits)
+{
+    FILE *file = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+    if (file == NULL)
+    {
+        fprintf(stderr, "[ERROR] could not open file \"%s\".\n", path);
+        return 1;
+    }
+    NdjsonSink sink = {
+        .out = init_strbuf(),
+        .arena = init_arena(0),
+        .json_options = json_options,
+        .cbor_options = cbor_options,
+    };
+    Arena *previous = ast_use_arena(sink.arena);
+    Lexer *lexer = init_lexer("", path);
+    Parser *parser = init_parser(lexer);
+    parser_set_limits(parser, *limits);
+    parser_stream(parser, ndjson_on_decl, &sink);
+
+    static char chunk[64 * 1024];
+    size_t got;
+    while ((got = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        parser_feed(parser, chunk, got);
+    int failed = ferror(file);
+    if (failed)
+        fprintf(stderr, "[ERROR] could not read file \"%s\".\n", path);
+    parser_finish(parser);
+    parser_print_diagnostics(parser);
+
+    if (file != stdin)
+        fclose(file);
+    parser_free(parser);
+    lexer_free(lexer);
+    ast_use_arena(previous);
+    arena_free(sink.arena);
+    strbuf_free(&sink.out);
+    return failed;
+}
+// parses every file with one lexer and parser while the reader fetches the next ones; one JSON line per file.
+static int parse_files(char **paths, size_t count, size_t depth, ReaderBackend backend, int hashcons,
+                       AST_JsonOptions *json_options, ParserLimits *limits)
+{
+    Reader *reader = init_reader(paths, count, depth, backend);
+    Arena *arena = init_arena(0);
+    Arena *previous = ast_use_arena(arena);
+    Lexer *lexer = init_lexer("", "<files>");
+    Parser *parser = init_parser(lexer);
+    if (hashcons)
+        parser_enable_hashcons(parser);
+    parser_set_limits(parser, *limits);
+    StrBuf out = init_strbuf();
+    int failed = 0;
+    ReaderFile file;
+    while (reader_next(reader, &file))
+    {
+        if (file.data == NULL)
+        {
+            fprintf(stderr, "[ERROR] could not read file \"%s\": %s.\n", file.path, strerror(file.error));
+            failed = 1;
+            continue;
+        }
+        lexer_reset(lexer, file.data, file.path);
+        parser_reset(parser, lexer);
+        AST *ast = parser_parse(parser);
+        parser_print_diagnostics(parser);
+        if (parser->had_error == 0)
+        {
+            strbuf_reset(&out);
+            strbuf_puts(&out, "{\"file\": ");
+            json_put_string(&out, file.path, strlen(file.path));
+            strbuf_puts(&out, ",\"ast\": ");
+            ast_write_json(&out, ast, json_options);
+            strbuf_puts(&out, "}\n");
+            fwrite(out.data, 1, out.length, stdout);
+        }
+        arena_reset(arena);
+        free(file.data);
+    }
+    strbuf_free(&out);
+    parser_free(parser);
+    lexer_free(lexer);
+    ast_use_arena(previous);
+    arena_free(arena);
+    reader_free(reader);
+    return failed;
+}
+// like diff(1): 0 when the trees are equal, 1 with one JSON edit per line when they are not, 2 when either fails.
+static int diff_files(char *before_path, char *after_path, ParserLimits *limits)
+{
+    char *paths[2] = {before_path, after_path};
+    char *sources[2] = {NULL, NULL};
+    Lexer *lexers[2] = {NULL, NULL};
+    Parser *parsers[2] = {NULL, NULL};
+    AST *trees[2] = {NULL, NULL};
+    int failed = 0;
+    for (int i = 0; i < 2 && !failed; i++)
+    {
+        sources[i] = readFile(paths[i]);
+        if (sources[i] == NULL)
+        {
+            failed = 1;
+            break;
+        }
+        lexers[i] = init_lexer(sources[i], paths[i]);
+        parsers[i] = init_parser(lexers[i]);
+        parser_set_limits(parsers[i], *limits);
+        trees[i] = parser_parse(parsers[i]);
+        parser_print_diagnostics(parsers[i]);
+        failed = parsers[i]->had_error;
+    }
+    int status = 2;
+    if (!failed)
+    {
+        ASTDiff *diff = ast_diff(trees[0], trees[1]);
+        StrBuf out = init_strbuf();
+        ast_diff_write_json(&out, diff);
+        if (out.length)
+            fwrite(out.data, 1, out.length, stdout);
+        status = diff->edits.count != 0;
+        strbuf_free(&out);
+        ast_diff_free(diff);
+    }
+    for (int i = 0; i < 2; i++)
+    {
+        ast_free(trees[i]);
+        if (parsers[i])
+            parser_free(parsers[i]);
+        if (lexers[i])
+            lexer_free(lexers[i]);
+        free(sources[i]);
+    }
+    return status;
+}
+// lexer only: the binary token stream of token_stream.h to stdout or output; 1 when the source has error tokens.
+static int tokens_file(char *path, char *output)
+{
+    char *source = readFile(path);
+    if (source == NULL)
+        return 1;
+    Lexer *lexer = init_lexer(source, path);
+    StrBuf out = init_strbuf();
+    StrBuf errors = init_strbuf();
+    size_t error_count = lexer_write_tokens(lexer, &out, &errors);
+    int failed = error_count != 0;
+    if (errors.length)
+        fwrite(errors.data, 1, errors.length, stderr);
+    if (error_count == SIZE_MAX)
+        fprintf(stderr, "[ERROR] \"%s\" is too large for a token stream.\n", path);
+    else
+    {
+        FILE *file = output ? fopen(output, "wb") : stdout;
+        if (file == NULL || fwrite(out.data, 1, out.length, file) != out.length || (output && fclose(file) != 0))
+        {
+            fprintf(stderr, "[ERROR] could not write the token stream to \"%s\".\n", output ? output : "stdout");
+            failed = 1;
+        }
+    }
+    strbuf_free(&out);
+    strbuf_free(&errors);
+    lexer_free(lexer);
+    free(source);
+    return failed;
+}
 void usage(char *argv[])
 {
-    fprintf(stderr, "[ERROR] %s <filename>\n", argv[0]);
+    fprintf(stderr,
+            "[ERROR] %s [--hashcons] [--dag-refs] [--format=json|cbor [--cbor-int-keys]] [--jobs N] "
+            "[--cache-dir DIR [--cache-size BYTES]] <filename>\n",
+            argv[0]);
+    fprintf(stderr, "[ERROR] %s [--format=json|cbor [--cbor-int-keys]] --ndjson <filename|->\n", argv[0]);
+    fprintf(stderr, "[ERROR] %s [--hashcons] --emit-c <filename>\n", argv[0]);
+    fprintf(stderr, "[ERROR] %s --diff <old> <new>\n", argv[0]);
+    fprintf(stderr, "[ERROR] %s --tokens [--output FILE] <filename>\n", argv[0]);
+    fprintf(stderr, "[ERROR] %s [--hashcons] [--dag-refs] [--read-ahead N] [--io=uring|pool] <path> <path>...\n",
+            argv[0]);
+    fprintf(stderr,
+            "[ERROR] limits for any mode: [--max-depth N] [--max-nodes N] [--max-bytes N] [--max-errors N] "
+            "[--max-steps N] [--timeout-ms N]\n");
+    fprintf(stderr, "[ERROR] %s [--hashcons] [--dag-refs] [--cbor-int-keys] [--workers N] --serve <socket>\n", argv[0]);
 }
 int main(int argc, char *argv[])
 {
-    if (argc < 2)
+    char *path = NULL;
+    char **paths = calloc((size_t)argc, sizeof(char *));
+    size_t path_count = 0;
+    size_t read_ahead = 0;
+    ReaderBackend backend = READER_AUTO;
+    char *socket_path = NULL;
+    char *cache_dir = NULL;
+    size_t cache_size = 256 * 1024 * 1024;
+    int workers = 0;
+    int hashcons = 0;
+    int ndjson = 0;
+    int cbor = 0;
+    int emit_c = 0;
+    int diff = 0;
+    int tokens = 0;
+    char *output = NULL;
+    int jobs = 1;
+    AST_JsonOptions json_options = {0};
+    AST_CborOptions cbor_options = {0};
+    ParserLimits limits = {0};
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--hashcons") == 0)
+            hashcons = 1;
+        else if (strcmp(argv[i], "--dag-refs") == 0)
+            hashcons = json_options.share_refs = cbor_options.share_refs = 1;
+        else if (strcmp(argv[i], "--format=json") == 0)
+            cbor = 0;
+        else if (strcmp(argv[i], "--format=cbor") == 0)
+            cbor = 1;
+        else if (strcmp(argv[i], "--cbor-int-keys") == 0)
+            cbor_options.integer_keys = 1;
+        else if (strcmp(argv[i], "--ndjson") == 0)
+            ndjson = 1;
+        else if (strcmp(argv[i], "--emit-c") == 0)
+            emit_c = 1;
+        else if (strcmp(argv[i], "--diff") == 0)
+            diff = 1;
+        else if (strcmp(argv[i], "--tokens") == 0)
+            tokens = 1;
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+            output = argv[++i];
+        else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc)
+            socket_path = argv[++i];
+        else if (strcmp(argv[i], "--max-depth") == 0 && i + 1 < argc)
+            limits.max_depth = (size_t)strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--max-nodes") == 0 && i + 1 < argc)
+            limits.max_nodes = (size_t)strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--max-bytes") == 0 && i + 1 < argc)
+            limits.max_bytes = (size_t)strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--max-errors") == 0 && i + 1 < argc)
+            limits.max_diagnostics = (size_t)strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--max-steps") == 0 && i + 1 < argc)
+            limits.max_steps = (size_t)strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--timeout-ms") == 0 && i + 1 < argc)
+            limits.max_millis = (size_t)strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--read-ahead") == 0 && i + 1 < argc)
+            read_ahead = (size_t)strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--io=uring") == 0)
+            backend = READER_URING;
+        else if (strcmp(argv[i], "--io=pool") == 0)
+            backend = READER_POOL;
+        else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc)
+            jobs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc)
+            workers = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--cache-dir") == 0 && i + 1 < argc)
+            cache_dir = argv[++i];
+        else if (strcmp(argv[i], "--cache-size") == 0 && i + 1 < argc)
+            cache_size = (size_t)strtoull(argv[++i], NULL, 10);
+        else if (argv[i][0] == '-' && argv[i][1] == '-')
+        {
+            usage(argv);
+            free(paths);
+            return 1;
+        }
+        else
+            path = paths[path_count++] = argv[i];
+    }
+    if (socket_path)
+    {
+        ServeOptions serve_options = {
+            .workers = workers,
+            .hashcons = hashcons,
+            .json = json_options,
+            .cbor = cbor_options,
+            .limits = limits,
+        };
+        free(paths);
+        return serve_run(socket_path, &serve_options);
+    }
+    if (path == NULL || (diff && path_count != 2))
     {
         usage(argv);
-        return 1;
+        free(paths);
+        return diff ? 2 : 1;
+    }
+    if (diff)
+    {
+        int status = diff_files(paths[0], paths[1], &limits);
+        free(paths);
+        return status;
+    }
+    if (tokens || output)
+    {
+        int failed = 1;
+        if (!tokens || path_count != 1)
+            usage(argv);
+        else
+            failed = tokens_file(path, output);
+        free(paths);
+        return failed;
+    }
+    // several paths or a directory read ahead through the reader instead of one readFile.
+    size_t file_count = 0;
+    char **files = reader_list(paths, path_count, &file_count);
+    free(paths);
+    if (path_count > 1 || file_count != 1 || strcmp(files[0], path) != 0)
+    {
+        int failed = 1;
+        if (ndjson || cbor || cache_dir)
+            fprintf(stderr, "[ERROR] --ndjson, --format=cbor and --cache-dir take a single file.\n");
+        else
+            failed = parse_files(files, file_count, read_ahead, backend, hashcons, &json_options, &limits);
+        reader_list_free(files, file_count);
+        return failed;
     }
-    char *path = argv[1];
+    reader_list_free(files, file_count);
+    if (ndjson)
+        return parse_ndjson(path, &json_options, cbor ? &cbor_options : NULL, &limits);
     char *source = readFile(path);
+    if (source == NULL)
+        return 1;
     if (strlen(source) == 0)
     {
         fprintf(stderr, "[ERROR] cannot parse '%s' empty file.\n", path);
         return 0;
     }
+    size_t source_len = strlen(source);
+    DiskCache *cache = cache_dir && !emit_c ? init_disk_cache(cache_dir, cache_size) : NULL;
+    uint64_t cache_key = 0;
+    if (cache)
+    {
+        size_t cached_len = 0;
+        uint64_t options = (uint64_t)json_options.share_refs | (uint64_t)cbor << 1 |
+                           (uint64_t)cbor_options.integer_keys << 2;
+        cache_key = disk_cache_key(source, source_len, options);
+        char *cached = disk_cache_get(cache, cache_key, source, source_len, &cached_len);
+        if (cached)
+        {
+            fwrite(cached, 1, cached_len, stdout);
+            free(cached);
+            free(source);
+            disk_cache_free(cache);
+            return 0;
+        }
+    }
     Lexer *lexer = init_lexer(source, path);
     Parser *parser = init_parser(lexer);
+    if (hashcons)
+        parser_enable_hashcons(parser);
+    parser_set_limits(parser, limits);
     AST *ast = parser_parse(parser);
-    free(source);
-    if (parser->had_error == 0)
+    parser_print_diagnostics(parser);
+    int failed = 0;
+    if (parser->had_error == 0 && emit_c)
     {
-        ast_print(ast);
-        ast_free(ast);
+        StrBuf out = init_strbuf();
+        StrBuf error = init_strbuf();
+        failed = aot_write_c(&out, ast->childs.items, array_size(&ast->childs), NULL, &error) != 0;
+        if (failed)
+            fprintf(stderr, "[ERROR] %s: %s\n", path, error.data);
+        else
+            fwrite(out.data, 1, out.length, stdout);
+        strbuf_free(&error);
+        strbuf_free(&out);
     }
+    else if (parser->had_error == 0 && !cbor && !cache)
+        ast_emit_json(stdout, ast, &json_options, jobs);
+    else if (parser->had_error == 0)
+    {
+        StrBuf out = init_strbuf();
+        if (cbor)
+        {
+            // stream straight to stdout unless the cache needs the whole encoding.
+            cbor_options.flush = cache ? NULL : stdout;
+            ast_write_cbor(&out, ast, &cbor_options);
+        }
+        else
+        {
+            ast_write_json(&out, ast, &json_options);
+            strbuf_putc(&out, '\n');
+        }
+        fwrite(out.data, 1, out.length, stdout);
+        if (cache)
+            disk_cache_put(cache, cache_key, source, source_len, out.data, out.length);
+        strbuf_free(&out);
+    }
+    ast_free(ast);
+    free(source);
+    disk_cache_free(cache);
     parser_free(parser);
     lexer_free(lexer);
+    return failed;
 }
\ No newline at end of file
@@ -0,0 +1,216 @@
+#include "parse_cache.h"
+#include "helper.h"
+#include "lexer.h"
+#include "parser.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define PARSE_CACHE_CHUNK 512
+#define PARSE_CACHE_SEED 0x63616368655f6b65ULL
+
+ParseCache *init_parse_cache(size_t max_bytes, size_t shard_count)
+{
+    ParseCache *cache = calloc(1, sizeof(ParseCache));
+    cache->shard_count = shard_count ? shard_count : 16;
+    cache->shards = calloc(cache->shard_count, sizeof(ParseCacheShard));
+    for (size_t i = 0; i < cache->shard_count; i++)
+    {
+        ParseCacheShard *shard = &cache->shards[i];
+        pthread_mutex_init(&shard->lock, NULL);
+        shard->bucket_count = 64;
+        shard->buckets = calloc(shard->bucket_count, sizeof(ParseCacheEntry *));
+        shard->max_bytes = max_bytes / cache->shard_count;
+    }
+    atomic_init(&cache->hits, 0);
+    atomic_init(&cache->misses, 0);
+    atomic_init(&cache->evictions, 0);
+    return cache;
+}
+static void parse_cache_entry_free(ParseCacheEntry *entry)
+{
+    arena_free(entry->arena);
+    free(entry->source);
+    free(entry);
+}
+void parse_cache_release(const ParseCacheEntry *entry)
+{
+    ParseCacheEntry *owned = (ParseCacheEntry *)entry;
+    if (owned && atomic_fetch_sub(&owned->refs, 1) == 1)
+        parse_cache_entry_free(owned);
+}
+// parses into a private arena so the whole tree is accounted for and freed in one go.
+static ParseCacheEntry *parse_cache_build(const char *source, size_t length, uint64_t hash)
+{
+    ParseCacheEntry *entry = calloc(1, sizeof(ParseCacheEntry));
+    entry->hash = hash;
+    entry->length = length;
+    entry->source = malloc(length + 1);
+    memcpy(entry->source, source, length);
+    entry->source[length] = '\0';
+    entry->arena = init_arena(PARSE_CACHE_CHUNK);
+
+    Arena *previous = ast_use_arena(entry->arena);
+    Lexer *lexer = init_lexer(entry->source, "<cache>");
+    Parser *parser = init_parser(lexer);
+    AST *ast = parser_parse(parser);
+    entry->had_error = parser->had_error;
+    entry->ast = parser->had_error ? NULL : ast;
+    parser_free(parser);
+    lexer_free(lexer);
+    ast_use_arena(previous);
+
+    entry->bytes = sizeof(ParseCacheEntry) + length + 1 + entry->arena->reserved;
+    atomic_init(&entry->refs, 1);
+    return entry;
+}
+static ParseCacheEntry **parse_cache_find(ParseCacheShard *shard, const char *source, size_t length, uint64_t hash)
+{
+    ParseCacheEntry **link = &shard->buckets[hash & (shard->bucket_count - 1)];
+    while (*link)
+    {
+        ParseCacheEntry *entry = *link;
+        if (entry->hash == hash && entry->length == length && memcmp(entry->source, source, length) == 0)
+            return link;
+        link = &entry->chain;
+    }
+    return link;
+}
+static void parse_cache_unlink(ParseCacheShard *shard, ParseCacheEntry *entry)
+{
+    if (entry->prev)
+        entry->prev->next = entry->next;
+    else
+        shard->newest = entry->next;
+    if (entry->next)
+        entry->next->prev = entry->prev;
+    else
+        shard->oldest = entry->prev;
+    entry->prev = entry->next = NULL;
+}
+static void parse_cache_push_newest(ParseCacheShard *shard, ParseCacheEntry *entry)
+{
+    entry->prev = NULL;
+    entry->next = shard->newest;
+    if (shard->newest)
+        shard->newest->prev = entry;
+    shard->newest = entry;
+    if (shard->oldest == NULL)
+        shard->oldest = entry;
+}
+static void parse_cache_grow(ParseCacheShard *shard)
+{
+    size_t bucket_count = shard->bucket_count * 2;
+    ParseCacheEntry **buckets = calloc(bucket_count, sizeof(ParseCacheEntry *));
+    for (size_t i = 0; i < shard->bucket_count; i++)
+    {
+        ParseCacheEntry *entry = shard->buckets[i];
+        while (entry)
+        {
+            ParseCacheEntry *chain = entry->chain;
+            size_t slot = entry->hash & (bucket_count - 1);
+            entry->chain = buckets[slot];
+            buckets[slot] = entry;
+            entry = chain;
+        }
+    }
+    free(shard->buckets);
+    shard->buckets = buckets;
+    shard->bucket_count = bucket_count;
+}
+static void parse_cache_evict(ParseCache *cache, ParseCacheShard *shard, ParseCacheEntry *keep)
+{
+    while (shard->bytes > shard->max_bytes && shard->oldest && shard->oldest != keep)
+    {
+        ParseCacheEntry *victim = shard->oldest;
+        ParseCacheEntry **link = parse_cache_find(shard, victim->source, victim->length, victim->hash);
+        *link = victim->chain;
+        parse_cache_unlink(shard, victim);
+        shard->bytes -= victim->bytes;
+        shard->count--;
+        atomic_fetch_add(&cache->evictions, 1);
+        parse_cache_release(victim);
+    }
+}
+const ParseCacheEntry *parse_cache_acquire(ParseCache *cache, const char *source, size_t length)
+{
+    uint64_t hash = helper_hash64(source, length, PARSE_CACHE_SEED);
+    ParseCacheShard *shard = &cache->shards[(hash >> 40) % cache->shard_count];
+
+    pthread_mutex_lock(&shard->lock);
+    ParseCacheEntry *entry = *parse_cache_find(shard, source, length, hash);
+    if (entry)
+    {
+        parse_cache_unlink(shard, entry);
+        parse_cache_push_newest(shard, entry);
+        atomic_fetch_add(&entry->refs, 1);
+        pthread_mutex_unlock(&shard->lock);
+        atomic_fetch_add(&cache->hits, 1);
+        return entry;
+    }
+    pthread_mutex_unlock(&shard->lock);
+    atomic_fetch_add(&cache->misses, 1);
+
+    // parse outside the lock; if another thread won the race its entry is used instead.
+    ParseCacheEntry *built = parse_cache_build(source, length, hash);
+    if (built->bytes > shard->max_bytes)
+        return built;
+
+    pthread_mutex_lock(&shard->lock);
+    ParseCacheEntry **link = parse_cache_find(shard, source, length, hash);
+    if (*link)
+    {
+        entry = *link;
+        atomic_fetch_add(&entry->refs, 1);
+        pthread_mutex_unlock(&shard->lock);
+        parse_cache_release(built);
+        return entry;
+    }
+    *link = built;
+    atomic_fetch_add(&built->refs, 1);
+    parse_cache_push_newest(shard, built);
+    shard->bytes += built->bytes;
+    shard->count++;
+    parse_cache_evict(cache, shard, built);
+    if (shard->count > shard->bucket_count)
+        parse_cache_grow(shard);
+    pthread_mutex_unlock(&shard->lock);
+    return built;
+}
+ParseCacheStats parse_cache_stats(ParseCache *cache)
+{
+    ParseCacheStats stats = {
+        .hits = atomic_load(&cache->hits),
+        .misses = atomic_load(&cache->misses),
+        .evictions = atomic_load(&cache->evictions),
+    };
+    for (size_t i = 0; i < cache->shard_count; i++)
+    {
+        ParseCacheShard *shard = &cache->shards[i];
+        pthread_mutex_lock(&shard->lock);
+        stats.entries += shard->count;
+        stats.bytes += shard->bytes;
+        pthread_mutex_unlock(&shard->lock);
+    }
+    return stats;
+}
+// entries still held by callers survive until their last parse_cache_release.
+void parse_cache_free(ParseCache *cache)
+{
+    if (cache == NULL)
+        return;
+    for (size_t i = 0; i < cache->shard_count; i++)
+    {
+        ParseCacheShard *shard = &cache->shards[i];
+        ParseCacheEntry *entry = shard->newest;
+        while (entry)
+        {
+            ParseCacheEntry *next = entry->next;
+            parse_cache_release(entry);
+            entry = next;
+        }
+        free(shard->buckets);
+        pthread_mutex_destroy(&shard->lock);
+    }
+    free(cache->shards);
+    free(cache);
+}
\ No newline at end of file
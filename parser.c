@@ -1,30 +1,10 @@
 #include "lexer.h"
 #include "parser.h"
 #include "token.h"
-#include "helper.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-
-#define parser_error_prefix()                                            \
-    do                                                                   \
-    {                                                                    \
-        fprintf(stderr, "ParserError at %s:", parser->lexer->file_path); \
-    } while (0)
-
-#define parser_token_location(token)                           \
-    do                                                         \
-    {                                                          \
-        fprintf(stderr, "%zu:%zu ", (token).row, (token).col); \
-    } while (0)
-#define parser_token_error(token, message) \
-    do                                     \
-    {                                      \
-        parser->had_error = 1;             \
-        parser_error_prefix();             \
-        parser_token_location(token);      \
-        fprintf(stderr, "%s\n", message);  \
-    } while (0)
+#include <time.h>
 
 char *parser_unexpected_token(Token token, char *message)
 {
@@ -47,95 +27,172 @@ char *parser_unexpected_token(Token token, char *message)
     return buffer;
 }
 
+#ifdef PARSER_TABLE_DISPATCH
 static ParseRule rules[] = {
-    [TOKEN_LPAREN] = {parser_parse_group, parser_parse_call, PREC_POSTIFX},
-    [TOKEN_RPAREN] = {NULL, NULL, PREC_NONE},
-    [TOKEN_MINUS] = {parser_parse_prefix, parser_parse_infix, PREC_TERM},
-    [TOKEN_PLUS] = {NULL, parser_parse_infix, PREC_TERM},
-    [TOKEN_SEMICOLON] = {NULL, NULL, PREC_NONE},
-    [TOKEN_DIV] = {NULL, parser_parse_infix, PREC_FACTOR},
-    [TOKEN_MUL] = {NULL, parser_parse_infix, PREC_FACTOR},
-    [TOKEN_NUMBER] = {parser_parse_number, NULL, PREC_NONE},
-    [TOKEN_EOF] = {NULL, NULL, PREC_NONE},
-    [TOKEN_ERROR] = {NULL, NULL, PREC_NONE},
-    [TOKEN_COMMA] = {NULL, parser_parse_comma, PREC_COMMA},
-    [TOKEN_QUESTION] = {NULL, parser_parse_ternary, PREC_TERNARY},
-    [TOKEN_TRUE] = {parser_parse_primary, NULL, PREC_NONE},
-    [TOKEN_FALSE] = {parser_parse_primary, NULL, PREC_NONE},
-    [TOKEN_NULL] = {parser_parse_primary, NULL, PREC_NONE},
-    [TOKEN_ID] = {parser_parse_primary, NULL, PREC_NONE},
-    [TOKEN_STRING] = {parser_parse_string, NULL, PREC_NONE},
-    [TOKEN_EQUALS] = {NULL, parser_parse_infix, PREC_EQUALITY},
-    [TOKEN_ASSIGNMENT] = {NULL, parser_parse_infix, PREC_ASSIGNMENT},
-    [TOKEN_NOT] = {parser_parse_prefix, NULL, PREC_UNARY},
-    [TOKEN_NOT_EQUALS] = {NULL, parser_parse_infix, PREC_EQUALITY},
-    [TOKEN_MOD] = {NULL, parser_parse_infix, PREC_FACTOR},
-    [TOKEN_RIGHT_SHIFT] = {NULL, parser_parse_infix, PREC_SHIFT},
-    [TOKEN_LEFT_SHIFT] = {NULL, parser_parse_infix, PREC_SHIFT},
-    [TOKEN_AND] = {NULL, parser_parse_infix, PREC_LOGICAL_AND},
-    [TOKEN_BITWISE_AND] = {NULL, parser_parse_infix, PREC_BITWISE_AND},
-    [TOKEN_OR] = {NULL, parser_parse_infix, PREC_LOGICAL_OR},
-    [TOKEN_BITWISE_OR] = {NULL, parser_parse_infix, PREC_BITWISE_OR},
-    [TOKEN_LTE] = {NULL, parser_parse_infix, PREC_COMPARISON},
-    [TOKEN_LT] = {NULL, parser_parse_infix, PREC_COMPARISON},
-    [TOKEN_GTE] = {NULL, parser_parse_infix, PREC_COMPARISON},
-    [TOKEN_GT] = {NULL, parser_parse_infix, PREC_COMPARISON},
-    [TOKEN_BITWISE_NOT] = {parser_parse_prefix, NULL, PREC_UNARY},
-    [TOKEN_INCREMENT] = {parser_parse_prefix, parser_parse_postfix, PREC_UNARY},
-    [TOKEN_DECREMENT] = {parser_parse_prefix, parser_parse_postfix, PREC_UNARY},
-    [TOKEN_LCURLY] = {NULL, NULL, PREC_NONE},
-    [TOKEN_RCURLY] = {NULL, NULL, PREC_NONE},
+#define X(token, prefix, infix, precedence, associativity) [token] = {prefix, infix, precedence, associativity},
+    PARSER_RULES(X)
+#undef X
 };
+#endif
 Parser *init_parser(Lexer *lexer)
 {
     Parser *parser = calloc(1, sizeof(Parser));
+    parser->hashcons = NULL;
+    init_array(&parser->diagnostics);
+    parser_reset(parser, lexer);
+    return parser;
+}
+void parser_reset(Parser *parser, Lexer *lexer)
+{
     parser->current_token = lexer_next_token(lexer);
+    parser->limit = PARSER_LIMIT_NONE;
+    parser->depth = parser->nodes = parser->bytes = parser->steps = parser->errors = 0;
     parser->had_error = 0;
     parser->panic_mode = 0;
     parser->lexer = lexer;
     parser->parsing_call = 0;
-    return parser;
+    if (parser->hashcons)
+        hashcons_clear(parser->hashcons);
+    if (parser->index)
+        ast_index_clear(parser->index);
+    if (parser->stream)
+        parser_stream(parser, parser->stream->on_decl, parser->stream->data);
+    parser_clear_diagnostics(parser);
+}
+void parser_enable_hashcons(Parser *parser)
+{
+    if (parser->hashcons == NULL)
+        parser->hashcons = init_hashcons();
+}
+void parser_set_limits(Parser *parser, ParserLimits limits)
+{
+    parser->limits = limits;
+}
+static double parser_clock(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+static void parser_start_clock(Parser *parser)
+{
+    if (parser->limits.max_millis)
+        parser->deadline = parser_clock() + (double)parser->limits.max_millis / 1e3;
+}
+// records why the parse stopped and jumps the lexer to EOF, so every loop and caller unwinds without more work.
+static void parser_abort(Parser *parser, ParserLimit limit, const char *message)
+{
+    if (parser->limit)
+        return;
+    Lexer *lexer = parser->lexer;
+    size_t length = strlen(message);
+    ParserDiagnostic diagnostic = {
+        .row = parser->current_token.row,
+        .col = parser->current_token.col,
+        .message = malloc(length + 1),
+    };
+    memcpy(diagnostic.message, message, length + 1);
+    array_push(&parser->diagnostics, diagnostic);
+    parser->limit = limit;
+    parser->had_error = 1;
+    parser->panic_mode = 1;
+    lexer->index = lexer->src_size;
+    lexer->current_char = '\0';
+    parser->current_token = init_token(&lexer->src[lexer->src_size], TOKEN_EOF, 0, lexer->row, lexer->col);
+}
+static void parser_charge(Parser *parser, size_t bytes)
+{
+    parser->bytes += bytes;
+    if (parser->limits.max_bytes && parser->bytes > parser->limits.max_bytes)
+        parser_abort(parser, PARSER_LIMIT_BYTES, "parse aborted, input needs too much memory.");
+}
+static AST *parser_node(Parser *parser, AST_Type type)
+{
+    parser->nodes++;
+    if (parser->limits.max_nodes && parser->nodes > parser->limits.max_nodes)
+        parser_abort(parser, PARSER_LIMIT_NODES, "parse aborted, too many nodes.");
+    parser_charge(parser, sizeof(AST));
+    return init_ast(type);
+}
+static char *parser_text(Parser *parser, Token token)
+{
+    parser_charge(parser, token.length + 1);
+    return ast_token_text(token);
+}
+static void parser_push(Parser *parser, AST *ast, AST *child)
+{
+    parser_charge(parser, sizeof(AST *));
+    ast_push(ast, child);
+}
+static int parser_enter(Parser *parser)
+{
+    if (parser->limit)
+        return 0;
+    if (parser->limits.max_depth && parser->depth >= parser->limits.max_depth)
+    {
+        parser_abort(parser, PARSER_LIMIT_DEPTH, "parse aborted, nesting is too deep.");
+        return 0;
+    }
+    parser->depth++;
+    return 1;
+}
+// parser_parse fills the index one top-level decl at a time, or at the end with hash-consing; push mode hands
+// decls to the callback instead.
+void parser_enable_index(Parser *parser)
+{
+    if (parser->index == NULL)
+        parser->index = init_ast_index();
+}
+// interned nodes stay reachable from the table until the parse ends, so they are not freed early.
+static void parser_discard(Parser *parser, AST *ast)
+{
+    if (parser->hashcons == NULL)
+        ast_free(ast);
+}
+static AST *parser_intern(Parser *parser, AST *ast)
+{
+    if (parser->hashcons == NULL)
+        return ast;
+    if (ast)
+    {
+        parser->left_row = ast->token.row;
+        parser->left_col = ast->token.col;
+    }
+    return hashcons_intern(parser->hashcons, ast);
+}
+// the token of the expression interned last, at its own position even when the node is shared.
+static Token parser_left_token(Parser *parser, AST *left)
+{
+    Token token = left->token;
+    if (parser->hashcons)
+    {
+        token.row = parser->left_row;
+        token.col = parser->left_col;
+    }
+    return token;
 }
 char *parser_prec_to_str(Precedence prec)
 {
-    switch (prec)
-    {
-    case PREC_NONE:
-        return "PREC_NONE";
-    case PREC_ASSIGNMENT:
-        return "PREC_ASSIGNMENT";
-    case PREC_BITWISE_AND:
-        return "PREC_BITWISE_AND";
-    case PREC_BITWISE_OR:
-        return "PREC_BITWISE_XOR";
-    case PREC_POSTIFX:
-        return "PREC_POSTIFX";
-    case PREC_UNARY:
-        return "PREC_UNARY";
-    case PREC_TERNARY:
-        return "PREC_TERNNARY";
-    case PREC_COMMA:
-        return "PREC_COMMA";
-    case PREC_COMPARISON:
-        return "PREC_COMPARISON";
-    case PREC_EQUALITY:
-        return "PREC_EQUALITY";
-    case PREC_FACTOR:
-        return "PREC_FACTOR";
-    case PREC_TERM:
-        return "PREC_TERM";
-    case PREC_LOGICAL_AND:
-        return "PREC_LOGICAL_AND";
-    case PREC_LOGICAL_OR:
-        return "PREC_LOGICAL_OR";
-    case PREC_SHIFT:
-        return "PREC_SHIFT";
-    default:
+    if ((unsigned)prec >= GRAMMAR_PRECEDENCE_COUNT)
         return "PREC_UNKNOWN";
-    }
+    return (char *)grammar_precedence_names[prec];
 }
 Token parser_advance(Parser *parser)
 {
+    if (parser->limit)
+        return parser->current_token;
+    parser->steps++;
+    if (parser->limits.max_steps && parser->steps > parser->limits.max_steps)
+    {
+        parser_abort(parser, PARSER_LIMIT_STEPS, "parse aborted, too many steps.");
+        return parser->current_token;
+    }
+    // reading the clock every token would cost more than the parse itself.
+    if (parser->limits.max_millis && (parser->steps & 1023) == 0 && parser_clock() > parser->deadline)
+    {
+        parser_abort(parser, PARSER_LIMIT_TIME, "parse aborted, time budget exceeded.");
+        return parser->current_token;
+    }
     parser->current_token = lexer_next_token(parser->lexer);
     return parser->current_token;
 }
@@ -143,7 +200,7 @@ Token parser_eat(Parser *parser, TokenType type, char *message)
 {
     if ((type != parser->current_token.type || type == TOKEN_ERROR) && parser->panic_mode == 0)
     {
-        parser_error(parser, parser_unexpected_token(parser->current_token, message));
+        parser_error_unexpected(parser, message);
         return parser->current_token;
     }
     else
@@ -154,36 +211,161 @@ Token parser_eat(Parser *parser, TokenType type, char *message)
         return token;
     }
 }
-ParseRule *parser_production(TokenType type)
+static int parser_at_boundary(Parser *parser)
 {
-    return &rules[type];
+    switch (parser->current_token.type)
+    {
+    case TOKEN_SEMICOLON:
+    case TOKEN_LCURLY:
+    case TOKEN_RCURLY:
+    case TOKEN_EOF:
+    case TOKEN_IF:
+    case TOKEN_PRINT:
+    case TOKEN_RETURN:
+    case TOKEN_VAR:
+    case TOKEN_FUNCTION:
+    case TOKEN_FOR:
+    case TOKEN_WHILE:
+        return 1;
+    default:
+        return 0;
+    }
+}
+// after an error, skips the raw bytes up to the next statement instead of tokenizing and parsing them.
+static void parser_synchronize(Parser *parser)
+{
+    if (!parser_at_boundary(parser))
+    {
+        lexer_sync(parser->lexer, LEXER_SYNC_STMT);
+        parser_advance(parser);
+    }
+    if (parser->current_token.type == TOKEN_SEMICOLON)
+        parser_advance(parser);
+    if (!parser->limit)
+        parser->panic_mode = 0;
+}
+static inline Precedence parser_rule_precedence(TokenType type)
+{
+#ifdef PARSER_TABLE_DISPATCH
+    return type < sizeof(rules) / sizeof(rules[0]) ? rules[type].precedence : PREC_NONE;
+#else
+    switch (type)
+    {
+#define X(token, prefix, infix, precedence, associativity) \
+    case token:                                           \
+        return precedence;
+        PARSER_RULES(X)
+#undef X
+    default:
+        return PREC_NONE;
+    }
+#endif
+}
+// the precedence the right operand of an infix token is parsed at; a right-associative one takes itself again.
+static inline Precedence parser_rule_right_precedence(TokenType type)
+{
+#ifdef PARSER_TABLE_DISPATCH
+    Precedence precedence = parser_rule_precedence(type);
+    return type < sizeof(rules) / sizeof(rules[0]) && rules[type].associativity == GRAMMAR_ASSOC_RIGHT
+               ? precedence
+               : precedence + 1;
+#else
+    switch (type)
+    {
+#define X(token, prefix, infix, precedence, associativity) \
+    case token:                                           \
+        return associativity == GRAMMAR_ASSOC_RIGHT ? precedence : precedence + 1;
+        PARSER_RULES(X)
+#undef X
+    default:
+        return PREC_NONE + 1;
+    }
+#endif
 }
 void parser_current_token(Parser *parser)
 {
-    printf("current token %s\n", token_to_str(parser->current_token));
+    char *token = token_to_str(parser->current_token);
+    fprintf(stderr, "current token %s\n", token);
+    free(token);
+}
+void parser_token_error(Parser *parser, Token token, const char *message)
+{
+    if (parser->limit)
+        return;
+    // a cascade reports the same token over and over; only its first error counts.
+    if (parser->errors > 0 && parser->error_row == token.row && parser->error_col == token.col)
+        return;
+    if (parser->limits.max_diagnostics && parser->errors >= parser->limits.max_diagnostics)
+    {
+        parser_abort(parser, PARSER_LIMIT_DIAGNOSTICS, "parse aborted, too many errors.");
+        return;
+    }
+    parser->had_error = 1;
+    parser->errors++;
+    parser->error_row = token.row;
+    parser->error_col = token.col;
+    size_t count = array_size(&parser->diagnostics);
+    if (count > PARSER_MAX_DIAGNOSTICS)
+        return;
+    if (count == PARSER_MAX_DIAGNOSTICS)
+        message = "too many errors, the rest are not reported.";
+    size_t length = strlen(message);
+    ParserDiagnostic diagnostic = {
+        .row = token.row,
+        .col = token.col,
+        .message = malloc(length + 1),
+    };
+    memcpy(diagnostic.message, message, length + 1);
+    array_push(&parser->diagnostics, diagnostic);
 }
-void parser_error(Parser *parser, char *message)
+void parser_error(Parser *parser, const char *message)
 {
     if (parser->panic_mode)
         return;
 
-    char *_message = message;
+    const char *_message = message;
     if (parser->current_token.message)
     {
         _message = parser->current_token.message;
     }
-    parser->had_error = 1;
     parser->panic_mode = 1;
-
-    parser_error_prefix();
-    parser_token_location(parser->current_token);
-    fprintf(stderr, "%s\n", _message);
+    parser_token_error(parser, parser->current_token, _message);
+}
+void parser_error_unexpected(Parser *parser, char *message)
+{
+    if (parser->panic_mode)
+        return;
+    // past the cap the message would be dropped anyway, so it is not formatted.
+    if (array_size(&parser->diagnostics) > PARSER_MAX_DIAGNOSTICS && !parser->limits.max_diagnostics)
+    {
+        parser->had_error = 1;
+        parser->panic_mode = 1;
+        return;
+    }
+    char *unexpected = parser_unexpected_token(parser->current_token, message);
+    parser_error(parser, unexpected);
+    free(unexpected);
+}
+void parser_print_diagnostics(Parser *parser)
+{
+    for (size_t i = 0; i < array_size(&parser->diagnostics); i++)
+    {
+        ParserDiagnostic *diagnostic = &array_at(&parser->diagnostics, i);
+        fprintf(stderr, "ParserError at %s:%zu:%zu %s\n", parser->lexer->file_path, diagnostic->row, diagnostic->col,
+                diagnostic->message);
+    }
+}
+void parser_clear_diagnostics(Parser *parser)
+{
+    for (size_t i = 0; i < array_size(&parser->diagnostics); i++)
+        free(array_at(&parser->diagnostics, i).message);
+    array_size(&parser->diagnostics) = 0;
 }
 AST *parser_parse_string(Parser *parser)
 {
-    AST *string = init_ast(AST_STRING);
+    AST *string = parser_node(parser, AST_STRING);
     string->token = parser->current_token;
-    string->name = token_text(parser->current_token);
+    string->name = parser_text(parser, parser->current_token);
     parser_eat(parser, TOKEN_STRING, 0);
     return string;
 }
@@ -194,14 +376,14 @@ AST *parser_parse_primary(Parser *parser)
     case TOKEN_TRUE:
     {
 
-        AST *ast_true = init_ast(AST_TRUE);
+        AST *ast_true = parser_node(parser, AST_TRUE);
         ast_true->token = parser->current_token;
         parser_eat(parser, TOKEN_TRUE, 0);
         return ast_true;
     }
     case TOKEN_FALSE:
     {
-        AST *ast_false = init_ast(AST_FALSE);
+        AST *ast_false = parser_node(parser, AST_FALSE);
         ast_false->token = parser->current_token;
         parser_eat(parser, TOKEN_FALSE, 0);
         return ast_false;
@@ -209,52 +391,95 @@ AST *parser_parse_primary(Parser *parser)
     case TOKEN_NULL:
     {
 
-        AST *ast_null = init_ast(AST_NULL);
+        AST *ast_null = parser_node(parser, AST_NULL);
         ast_null->token = parser->current_token;
         parser_eat(parser, TOKEN_NULL, 0);
         return ast_null;
     }
     default:
     {
-        AST *primary = init_ast(AST_ID);
-        primary->name = token_text(parser->current_token);
+        AST *primary = parser_node(parser, AST_ID);
+        primary->name = parser_text(parser, parser->current_token);
         primary->token = parser->current_token;
         parser_eat(parser, TOKEN_ID, 0);
         return primary;
     }
     }
 }
-AST *parser_parse_precendence(Parser *parser, Precedence precedence)
+AST *parser_parse_no_prefix(Parser *parser)
 {
-    ParsePrefixFn prefix_handler = parser_production(parser->current_token.type)->prefix;
-    if (prefix_handler == NULL)
-    {
-        parser_error(parser, parser_unexpected_token(parser->current_token, "expected an expr."));
-        if (parser->current_token.type == TOKEN_EOF)
-            return NULL;
+    parser_error_unexpected(parser, "expected an expr.");
+    if (parser->current_token.type != TOKEN_EOF)
         parser_advance(parser);
-        return NULL;
+    return NULL;
+}
+AST *parser_parse_no_infix(Parser *parser, AST *prefix)
+{
+    (void)parser;
+    return prefix;
+}
+#ifdef PARSER_TABLE_DISPATCH
+static AST *parser_dispatch(Parser *parser, Precedence precedence)
+{
+    TokenType type = parser->current_token.type;
+    ParsePrefixFn prefix_handler = type < sizeof(rules) / sizeof(rules[0]) ? rules[type].prefix : NULL;
+    if (prefix_handler == NULL || prefix_handler == parser_parse_no_prefix)
+        return parser_parse_no_prefix(parser);
+    AST *prefix = parser_intern(parser, prefix_handler(parser));
+    // a prefix that failed leaves nothing for an infix rule to take as its left side.
+    while (prefix && precedence <= parser_rule_precedence(type = parser->current_token.type))
+        prefix = parser_intern(parser, rules[type].infix(parser, prefix));
+    return prefix;
+}
+#else
+static AST *parser_dispatch(Parser *parser, Precedence precedence)
+{
+    AST *prefix;
+    switch (parser->current_token.type)
+    {
+#define X(token, prefix_fn, infix_fn, rule_precedence, associativity) \
+    case token:                                                      \
+        if (prefix_fn == parser_parse_no_prefix)                     \
+            return parser_parse_no_prefix(parser);                   \
+        prefix = prefix_fn(parser);                                  \
+        break;
+        PARSER_RULES(X)
+#undef X
+    default:
+        return parser_parse_no_prefix(parser);
     }
-    AST *prefix = prefix_handler(parser);
-    while (precedence <= parser_production(parser->current_token.type)->precedence)
+    prefix = parser_intern(parser, prefix);
+    // a prefix that failed leaves nothing for an infix rule to take as its left side.
+    while (prefix)
     {
-        ParseInfixFn infix_handler = parser_production(parser->current_token.type)->infix;
-        if (infix_handler == NULL)
+        switch (parser->current_token.type)
         {
-            printf("infix_handler is null for token %s\n", token_to_str(parser->current_token));
+#define X(token, prefix_fn, infix_fn, rule_precedence, associativity)  \
+    case token:                                                       \
+        if (precedence > rule_precedence)                             \
+            return prefix;                                            \
+        prefix = parser_intern(parser, infix_fn(parser, prefix));     \
+        continue;
+            PARSER_RULES(X)
+#undef X
+        default:
             return prefix;
         }
-        else
-        {
-            prefix = infix_handler(parser, prefix);
-        }
     }
-
-    return prefix;
+    return NULL;
+}
+#endif
+AST *parser_parse_precendence(Parser *parser, Precedence precedence)
+{
+    if (!parser_enter(parser))
+        return NULL;
+    AST *ast = parser_dispatch(parser, precedence);
+    parser->depth--;
+    return ast;
 }
 AST *parser_parse_number(Parser *parser)
 {
-    AST *number = init_ast(AST_NUMBER);
+    AST *number = parser_node(parser, AST_NUMBER);
     number->token = parser->current_token;
     char buffer[parser->current_token.length + 1];
     sprintf(buffer, "%.*s", (int)parser->current_token.length, parser->current_token.start);
@@ -274,14 +499,15 @@ AST *parser_parse_group(Parser *parser)
     AST *group = parser_parse_expr(parser);
     if (group && parser->current_token.type != TOKEN_RPAREN && parser->current_token.type != TOKEN_EOF)
     {
-        parser_error(parser, parser_unexpected_token(parser->current_token, "expected ',' or ')' after expression."));
-
-        while (parser->current_token.type != TOKEN_RPAREN)
+        parser_error_unexpected(parser, "expected ',' or ')' after expression.");
+        if (!parser_at_boundary(parser))
         {
+            lexer_sync(parser->lexer, LEXER_SYNC_GROUP);
             parser_advance(parser);
-            if (parser->current_token.type == TOKEN_EOF)
-                break;
         }
+        // the group never closed, the statement is recovered by parser_synchronize instead.
+        if (parser->current_token.type != TOKEN_RPAREN)
+            return group;
     }
     if (group)
         parser_eat(parser, TOKEN_RPAREN, "expected ')'.");
@@ -291,9 +517,12 @@ AST *parser_parse_call(Parser *parser, AST *callee)
 {
     if (callee->type != AST_ID)
     {
-        parser_token_error(callee->token, parser_unexpected_token(callee->token, "callee should be a identifier."));
+        Token token = parser_left_token(parser, callee);
+        char *message = parser_unexpected_token(token, "callee should be a identifier.");
+        parser_token_error(parser, token, message);
+        free(message);
     }
-    AST *call = init_ast(AST_FUNCTION_CALL);
+    AST *call = parser_node(parser, AST_FUNCTION_CALL);
     call->left = callee;
     parser->parsing_call = 1;
     call->value = parser_parse_group(parser);
@@ -302,24 +531,27 @@ AST *parser_parse_call(Parser *parser, AST *callee)
 }
 AST *parser_parse_prefix(Parser *parser)
 {
-    AST *unary = init_ast(AST_UNARY);
+    AST *unary = parser_node(parser, AST_UNARY);
     unary->token = parser->current_token;
-    unary->name = token_text(parser->current_token);
+    unary->name = parser_text(parser, parser->current_token);
     Token token = parser_eat(parser, parser->current_token.type, 0);
     AST *operand = parser_parse_precendence(parser, PREC_UNARY);
     if ((token.type == TOKEN_INCREMENT || token.type == TOKEN_DECREMENT) && operand && operand->type != AST_ID)
     {
-        parser_token_error(operand->token, "invalid expr in prefix operation.");
+        parser_token_error(parser, parser_left_token(parser, operand), "invalid expr in prefix operation.");
     }
     if (operand == NULL)
+    {
+        parser_discard(parser, unary);
         return NULL;
+    }
     unary->value = operand;
     return unary;
 }
 AST *parser_parse_comma(Parser *parser, AST *prefix)
 {
-    AST *exprs = init_ast(AST_SEQUENCEEXPR);
-    ast_push(exprs, prefix);
+    AST *exprs = parser_node(parser, AST_SEQUENCEEXPR);
+    parser_push(parser, exprs, prefix);
     while (parser->current_token.type == TOKEN_COMMA)
     {
         parser_eat(parser, TOKEN_COMMA, 0);
@@ -327,31 +559,38 @@ AST *parser_parse_comma(Parser *parser, AST *prefix)
         if (child == NULL)
         {
             parser->panic_mode = 1;
+            parser_discard(parser, exprs);
             return NULL;
         }
-        ast_push(exprs, child);
+        parser_push(parser, exprs, child);
     }
+    ast_shrink(exprs);
     return exprs;
 }
 AST *parser_parse_infix(Parser *parser, AST *prefix)
 {
-    AST *bin = init_ast(AST_BINARY);
+    AST *bin = parser_node(parser, AST_BINARY);
     bin->token = parser->current_token;
     Token token = parser_eat(parser, parser->current_token.type, 0);
 
     if (token.type == TOKEN_ASSIGNMENT && prefix && prefix->type != AST_ID && prefix->token.type != TOKEN_ASSIGNMENT)
     {
-        parser_token_error(prefix->token, "lvalue cannot be a constant.");
+        parser_token_error(parser, parser_left_token(parser, prefix), "lvalue cannot be a constant.");
+        parser_discard(parser, bin);
+        parser_discard(parser, prefix);
         return NULL;
     }
 
-    bin->name = token_text(token);
-    ParseRule *rule = parser_production(token.type);
-    Precedence precedence = token.type == TOKEN_ASSIGNMENT ? PREC_ASSIGNMENT : rule->precedence + 1;
+    bin->name = parser_text(parser, token);
+    Precedence precedence = parser_rule_right_precedence(token.type);
     AST *right = parser_parse_precendence(parser, precedence);
 
     if (right == NULL)
+    {
+        parser_discard(parser, bin);
+        parser_discard(parser, prefix);
         return NULL;
+    }
     bin->left = prefix;
     bin->right = right;
 
@@ -359,9 +598,9 @@ AST *parser_parse_infix(Parser *parser, AST *prefix)
 }
 AST *parser_parse_ternary(Parser *parser, AST *condition)
 {
-    AST *ternary = init_ast(AST_TERNARY);
+    AST *ternary = parser_node(parser, AST_TERNARY);
     ternary->token = parser->current_token;
-    ternary->name = token_text(parser->current_token);
+    ternary->name = parser_text(parser, parser->current_token);
     ternary->value = condition;
     TokenType operatorType = parser->current_token.type;
     parser_eat(parser, operatorType, 0);
@@ -369,9 +608,10 @@ AST *parser_parse_ternary(Parser *parser, AST *condition)
     if (parser->current_token.type != TOKEN_COLON)
     {
         parser_error(parser, "expect ':' after expr.");
+        parser_discard(parser, then);
+        parser_discard(parser, ternary);
         return NULL;
     }
-    then->token = parser->current_token;
     parser_eat(parser, TOKEN_COLON, 0);
     AST *_else = parser_parse_expr(parser);
     ternary->left = then;
@@ -380,9 +620,9 @@ AST *parser_parse_ternary(Parser *parser, AST *condition)
 }
 AST *parser_parse_postfix(Parser *parser, AST *oprand)
 {
-    AST *postfix = init_ast(AST_POSTFIX);
+    AST *postfix = parser_node(parser, AST_POSTFIX);
     postfix->token = parser->current_token;
-    postfix->name = token_text(parser->current_token);
+    postfix->name = parser_text(parser, parser->current_token);
     postfix->value = oprand;
     parser_eat(parser, parser->current_token.type, "expected posfix something");
     return postfix;
@@ -390,7 +630,7 @@ AST *parser_parse_postfix(Parser *parser, AST *oprand)
 void parser_state(Parser *parser)
 {
     parser_current_token(parser);
-    printf("had_error %d\npanic_mode %d\n", parser->had_error, parser->panic_mode);
+    fprintf(stderr, "had_error %d\npanic_mode %d\n", parser->had_error, parser->panic_mode);
 }
 AST *parser_parse_expr(Parser *parser)
 {
@@ -399,15 +639,24 @@ AST *parser_parse_expr(Parser *parser)
 }
 AST *parser_parse_print(Parser *parser)
 {
-    AST *print = init_ast(AST_STMT);
+    AST *print = parser_node(parser, AST_STMT);
     print->token = parser->current_token;
-    print->name = token_text(parser->current_token);
+    print->name = parser_text(parser, parser->current_token);
     parser_eat(parser, TOKEN_PRINT, 0);
     print->value = parser_parse_expr(parser);
     if (print->value == NULL)
+    {
+        parser_discard(parser, print);
         return NULL;
+    }
     return print;
 }
+AST *parser_parse_unsupported(Parser *parser)
+{
+    parser_error_unexpected(parser, "not supported yet.");
+    parser_advance(parser);
+    return NULL;
+}
 AST *parser_parse_stmt(Parser *parser)
 {
     TokenType token_type = parser->current_token.type;
@@ -430,19 +679,18 @@ AST *parser_parse_stmt(Parser *parser)
         stmt = parser_parse_print(parser);
         break;
     case TOKEN_RETURN:
-        UNIMPLEMENTED;
-        break;
+        return parser_parse_unsupported(parser);
     default:
         stmt = parser_parse_expr(parser);
     }
-    if (stmt)
+    if (stmt && !parser->panic_mode)
         parser_eat(parser, TOKEN_SEMICOLON, "statement should be ended with semicolon.");
     return stmt;
 }
 AST *parser_parse_if(Parser *parser)
 {
     parser_eat(parser, TOKEN_IF, 0);
-    AST *_if = init_ast(AST_IF);
+    AST *_if = parser_node(parser, AST_IF);
     _if->value = parser_parse_group(parser);
 
     if (parser->current_token.type == TOKEN_SEMICOLON)
@@ -459,23 +707,16 @@ AST *parser_parse_if(Parser *parser)
 
     return _if;
 }
-AST *parser_parse_decl(Parser *parser)
+static AST *parser_parse_decl_body(Parser *parser)
 {
     TokenType token_type = parser->current_token.type;
     switch (token_type)
     {
     case TOKEN_VAR:
-        token_print(parser->current_token);
-        UNIMPLEMENTED;
     case TOKEN_FUNCTION:
-        token_print(parser->current_token);
-        UNIMPLEMENTED;
     case TOKEN_FOR:
-        token_print(parser->current_token);
-        UNIMPLEMENTED;
     case TOKEN_WHILE:
-        token_print(parser->current_token);
-        UNIMPLEMENTED;
+        return parser_parse_unsupported(parser);
     case TOKEN_IF:
         return parser_parse_if(parser);
     case TOKEN_ELSE:
@@ -488,25 +729,196 @@ AST *parser_parse_decl(Parser *parser)
         return parser_parse_stmt(parser);
     }
 }
-AST *parser_parse_compound(Parser *parser)
+AST *parser_parse_decl(Parser *parser)
+{
+    if (!parser_enter(parser))
+        return NULL;
+    AST *decl = parser_parse_decl_body(parser);
+    parser->depth--;
+    return decl;
+}
+static AST *parser_parse_decls(Parser *parser, ASTIndex *index)
 {
-    AST *compound = init_ast(AST_COMPOUND);
+    // under hash-consing a later decl can still share a node, so the tree is indexed once it is whole.
+    ASTIndex *each = parser->hashcons ? NULL : index;
+    AST *compound = parser_node(parser, AST_COMPOUND);
+    if (each)
+        ast_index_add(each, compound);
     while (parser->current_token.type != TOKEN_EOF)
     {
         AST *child = parser_parse_decl(parser);
+        if (parser->panic_mode)
+            parser_synchronize(parser);
         if (child)
-            ast_push(compound, child);
+            parser_push(parser, compound, child);
+        if (child && each)
+            ast_index_add(each, child);
         if (parser->current_token.type == TOKEN_RCURLY)
             break;
     }
+    if (index && each == NULL)
+        ast_index_add(index, compound);
+    ast_shrink(compound);
     return compound;
 }
+AST *parser_parse_compound(Parser *parser)
+{
+    return parser_parse_decls(parser, NULL);
+}
 AST *parser_parse(Parser *parser)
 {
-    return parser_parse_compound(parser);
+    parser_start_clock(parser);
+    return parser_parse_decls(parser, parser->index);
+}
+void parser_stream(Parser *parser, ParserDeclFn on_decl, void *data)
+{
+    // a rolled back decl is freed outright, which would leave dangling entries in the hash-consing table.
+    hashcons_free(parser->hashcons);
+    parser->hashcons = NULL;
+    if (parser->stream == NULL)
+    {
+        parser->stream = calloc(1, sizeof(ParserStream));
+        parser->stream->pending = init_strbuf();
+        strbuf_reserve(&parser->stream->pending, 0);
+    }
+    ParserStream *stream = parser->stream;
+    strbuf_reset(&stream->pending);
+    stream->row = 1;
+    stream->col = 1;
+    stream->starved_at = 0;
+    stream->done = 0;
+    stream->on_decl = on_decl;
+    stream->data = data;
+    parser->lexer->streaming = 1;
+    parser_start_clock(parser);
+}
+typedef struct
+{
+    size_t diagnostics;
+    int had_error;
+    int panic_mode;
+    size_t nodes;
+    size_t bytes;
+    size_t steps;
+    size_t errors;
+    size_t error_row;
+    size_t error_col;
+} ParserSnapshot;
+
+static ParserSnapshot parser_snapshot(Parser *parser)
+{
+    ParserSnapshot snapshot = {
+        .diagnostics = array_size(&parser->diagnostics),
+        .had_error = parser->had_error,
+        .panic_mode = parser->panic_mode,
+        .nodes = parser->nodes,
+        .bytes = parser->bytes,
+        .steps = parser->steps,
+        .errors = parser->errors,
+        .error_row = parser->error_row,
+        .error_col = parser->error_col,
+    };
+    return snapshot;
+}
+static void parser_rollback(Parser *parser, ParserSnapshot snapshot)
+{
+    for (size_t i = snapshot.diagnostics; i < array_size(&parser->diagnostics); i++)
+        free(array_at(&parser->diagnostics, i).message);
+    array_size(&parser->diagnostics) = snapshot.diagnostics;
+    parser->had_error = snapshot.had_error;
+    parser->panic_mode = snapshot.panic_mode;
+    parser->nodes = snapshot.nodes;
+    parser->bytes = snapshot.bytes;
+    parser->steps = snapshot.steps;
+    // a decl parsed again must not look like a repeat of its own first attempt's error.
+    parser->errors = snapshot.errors;
+    parser->error_row = snapshot.error_row;
+    parser->error_col = snapshot.error_col;
+    parser->parsing_call = 0;
+}
+// parses whole top-level decls out of the pending buffer, re-lexing each one from its first token.
+static size_t parser_drain(Parser *parser)
+{
+    ParserStream *stream = parser->stream;
+    Lexer *lexer = parser->lexer;
+    size_t offset = 0;
+    size_t delivered = 0;
+    while (!stream->done)
+    {
+        lexer_resume(lexer, stream->pending.data + offset, stream->pending.length - offset, stream->row, stream->col);
+        parser->current_token = lexer_next_token(lexer);
+        if (parser->current_token.type == TOKEN_EOF || lexer->starved)
+        {
+            // a long comment still open at the end is not rescanned on every small chunk either.
+            if (lexer->starved)
+                stream->starved_at = stream->pending.length - offset;
+            break;
+        }
+
+        ParserSnapshot snapshot = parser_snapshot(parser);
+        AST *decl = parser_parse_decl(parser);
+        if (parser->panic_mode)
+            parser_synchronize(parser);
+        // a limit would trip on the same prefix again, so it ends the stream even when more input could follow.
+        if (parser->limit)
+        {
+            ast_free(decl);
+            stream->done = 1;
+            break;
+        }
+        if (lexer->starved)
+        {
+            ast_free(decl);
+            parser_rollback(parser, snapshot);
+            stream->starved_at = stream->pending.length - offset;
+            break;
+        }
+        stream->starved_at = 0;
+        offset += lexer->token_index;
+        stream->row = parser->current_token.row;
+        stream->col = parser->current_token.col;
+        if (decl)
+        {
+            stream->on_decl(decl, stream->data);
+            delivered++;
+        }
+        // parser_parse_compound stops at a stray top-level '}', so the stream does too.
+        if (parser->current_token.type == TOKEN_RCURLY)
+            stream->done = 1;
+    }
+    memmove(stream->pending.data, stream->pending.data + offset, stream->pending.length - offset);
+    stream->pending.length -= offset;
+    stream->pending.data[stream->pending.length] = '\0';
+    return delivered;
+}
+size_t parser_feed(Parser *parser, const char *chunk, size_t length)
+{
+    ParserStream *stream = parser->stream;
+    if (stream->done)
+        return 0;
+    strbuf_append(&stream->pending, chunk, length);
+    // retrying a long decl on every small chunk is quadratic, so wait until it doubles or may have ended.
+    if (stream->starved_at && stream->pending.length < stream->starved_at * 2 && memchr(chunk, ';', length) == NULL &&
+        memchr(chunk, '}', length) == NULL)
+        return 0;
+    return parser_drain(parser);
+}
+size_t parser_finish(Parser *parser)
+{
+    parser->lexer->streaming = 0;
+    size_t delivered = parser_drain(parser);
+    parser->stream->done = 1;
+    return delivered;
 }
 
 void parser_free(Parser *parser)
 {
+    hashcons_free(parser->hashcons);
+    ast_index_free(parser->index);
+    if (parser->stream)
+        strbuf_free(&parser->stream->pending);
+    free(parser->stream);
+    parser_clear_diagnostics(parser);
+    array_free(&parser->diagnostics);
     free(parser);
 }
\ No newline at end of file
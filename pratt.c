@@ -0,0 +1,71 @@
+#include "pratt.h"
+#include "lexer.h"
+#include "parser.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define PRATT_MAX_CHUNK (1024 * 1024)
+
+// everything the tree points at, including the source copy, lives in result->arena.
+int pratt_parse(const char *buf, size_t len, const pratt_options *options, pratt_result *result)
+{
+    if (result == NULL)
+        return PRATT_ERROR_INVALID_ARGUMENT;
+    memset(result, 0, sizeof(pratt_result));
+    if (buf == NULL && len != 0)
+        return result->status = PRATT_ERROR_INVALID_ARGUMENT;
+
+    size_t chunk_size = len * 4 + 1024;
+    result->arena = init_arena(chunk_size < PRATT_MAX_CHUNK ? chunk_size : PRATT_MAX_CHUNK);
+    char *source = arena_strndup(result->arena, buf ? buf : "", len);
+    char *path = (char *)(options && options->file_path ? options->file_path : "<input>");
+
+    Arena *previous = ast_use_arena(result->arena);
+    Lexer lexer = {0};
+    lexer_reset(&lexer, source, path);
+    Parser *parser = init_parser(&lexer);
+    if (options && options->hashcons)
+        parser_enable_hashcons(parser);
+    if (options && options->index)
+        parser_enable_index(parser);
+    if (options)
+        parser_set_limits(parser, options->limits);
+    AST *ast = parser_parse(parser);
+    ast_use_arena(previous);
+
+    result->status = parser->had_error ? PRATT_ERROR_SYNTAX : PRATT_OK;
+    if (parser->limit)
+        result->status = PRATT_ERROR_LIMIT_DEPTH + (int)parser->limit - PARSER_LIMIT_DEPTH;
+    result->ast = parser->had_error ? NULL : ast;
+    result->diagnostics = parser->diagnostics.items;
+    result->diagnostic_count = array_size(&parser->diagnostics);
+    init_array(&parser->diagnostics);
+    if (!parser->had_error)
+    {
+        result->index = parser->index;
+        parser->index = NULL;
+    }
+    parser_free(parser);
+    return result->status;
+}
+const ASTSnapshot *pratt_result_freeze(pratt_result *result)
+{
+    if (result == NULL || result->ast == NULL)
+        return NULL;
+    const ASTSnapshot *snapshot = ast_freeze(result->ast, result->arena, result->index);
+    result->ast = NULL;
+    result->arena = NULL;
+    result->index = NULL;
+    return snapshot;
+}
+void pratt_result_free(pratt_result *result)
+{
+    if (result == NULL)
+        return;
+    for (size_t i = 0; i < result->diagnostic_count; i++)
+        free(result->diagnostics[i].message);
+    free(result->diagnostics);
+    ast_index_free(result->index);
+    arena_free(result->arena);
+    memset(result, 0, sizeof(pratt_result));
+}
\ No newline at end of file
@@ -0,0 +1,513 @@
+#define _GNU_SOURCE
+#include "reader.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define READER_HAVE_URING
+#endif
+
+// one read moves at most this much, longer files take several.
+#define READER_MAX_READ (1u << 30)
+#define READER_MAX_THREADS 16
+
+struct ReaderSlot
+{
+    ReaderFile file;
+    int fd;
+    size_t done;
+    struct iovec iov;
+};
+
+static void reader_fail(ReaderFile *file, int error)
+{
+    free(file->data);
+    file->data = NULL;
+    file->length = 0;
+    file->error = error;
+}
+// opens path and allocates a buffer for all of it; on failure the file carries the errno and fd stays -1.
+static void reader_open(char *path, ReaderFile *file, int *fd)
+{
+    memset(file, 0, sizeof(ReaderFile));
+    file->path = path;
+    *fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (*fd < 0 || fstat(*fd, &st) != 0)
+        file->error = errno;
+    else if (!S_ISREG(st.st_mode))
+        file->error = S_ISDIR(st.st_mode) ? EISDIR : EINVAL;
+    if (file->error)
+    {
+        if (*fd >= 0)
+            close(*fd);
+        *fd = -1;
+        return;
+    }
+    file->length = (size_t)st.st_size;
+    file->data = malloc(file->length + 1);
+    if (file->data == NULL)
+    {
+        file->error = ENOMEM;
+        close(*fd);
+        *fd = -1;
+        return;
+    }
+    file->data[file->length] = '\0';
+}
+// a file that shrank since fstat ends early; one that grew is cut at its old size.
+static void reader_finish(ReaderFile *file, int fd, size_t done)
+{
+    while (file->data && done < file->length)
+    {
+        size_t want = file->length - done;
+        ssize_t got = pread(fd, file->data + done, want < READER_MAX_READ ? want : READER_MAX_READ, (off_t)done);
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got < 0)
+            reader_fail(file, errno);
+        else if (got == 0)
+        {
+            file->length = done;
+            file->data[done] = '\0';
+        }
+        else
+            done += (size_t)got;
+    }
+    if (fd >= 0)
+        close(fd);
+}
+static void *reader_worker(void *arg)
+{
+    Reader *reader = arg;
+    pthread_mutex_lock(&reader->lock);
+    for (;;)
+    {
+        // finished files count against depth until they are taken, so a slow consumer stops the readers.
+        while (reader->claimed < reader->count && reader->done_count + reader->in_flight >= reader->depth)
+            pthread_cond_wait(&reader->space, &reader->lock);
+        if (reader->claimed >= reader->count)
+            break;
+        char *path = reader->paths[reader->claimed++];
+        reader->in_flight++;
+        pthread_mutex_unlock(&reader->lock);
+
+        ReaderFile file;
+        int fd;
+        reader_open(path, &file, &fd);
+        reader_finish(&file, fd, 0);
+
+        pthread_mutex_lock(&reader->lock);
+        reader->in_flight--;
+        reader->done[(reader->done_head + reader->done_count++) % reader->depth] = file;
+        pthread_cond_signal(&reader->ready);
+    }
+    pthread_mutex_unlock(&reader->lock);
+    return NULL;
+}
+static int reader_pool_next(Reader *reader, ReaderFile *file)
+{
+    pthread_mutex_lock(&reader->lock);
+    while (reader->done_count == 0)
+        pthread_cond_wait(&reader->ready, &reader->lock);
+    *file = reader->done[reader->done_head];
+    reader->done_head = (reader->done_head + 1) % reader->depth;
+    reader->done_count--;
+    reader->delivered++;
+    pthread_cond_signal(&reader->space);
+    pthread_mutex_unlock(&reader->lock);
+    return 1;
+}
+static void reader_pool_start(Reader *reader)
+{
+    reader->backend = READER_POOL;
+    pthread_mutex_init(&reader->lock, NULL);
+    pthread_cond_init(&reader->ready, NULL);
+    pthread_cond_init(&reader->space, NULL);
+    reader->done = calloc(reader->depth, sizeof(ReaderFile));
+    reader->thread_count = reader->depth < READER_MAX_THREADS ? reader->depth : READER_MAX_THREADS;
+    if (reader->thread_count > reader->count)
+        reader->thread_count = reader->count;
+    reader->threads = calloc(reader->thread_count ? reader->thread_count : 1, sizeof(pthread_t));
+    for (size_t i = 0; i < reader->thread_count; i++)
+        pthread_create(&reader->threads[i], NULL, reader_worker, reader);
+}
+static void reader_pool_stop(Reader *reader)
+{
+    pthread_mutex_lock(&reader->lock);
+    reader->claimed = reader->count;
+    pthread_cond_broadcast(&reader->space);
+    pthread_mutex_unlock(&reader->lock);
+    for (size_t i = 0; i < reader->thread_count; i++)
+        pthread_join(reader->threads[i], NULL);
+    for (size_t i = 0; i < reader->done_count; i++)
+        free(reader->done[(reader->done_head + i) % reader->depth].data);
+    free(reader->done);
+    free(reader->threads);
+    pthread_cond_destroy(&reader->space);
+    pthread_cond_destroy(&reader->ready);
+    pthread_mutex_destroy(&reader->lock);
+}
+
+#ifdef READER_HAVE_URING
+// the rings are shared with the kernel, so head and tail are read and published with acquire/release.
+struct ReaderRing
+{
+    int fd;
+    int failed;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_map;
+    size_t sq_map_size;
+    void *cq_map;
+    size_t cq_map_size;
+    size_t sqes_size;
+    unsigned to_submit;
+};
+
+static void reader_ring_close(ReaderRing *ring)
+{
+    if (ring->sqes && ring->sqes != MAP_FAILED)
+        munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_map && ring->cq_map != MAP_FAILED && ring->cq_map != ring->sq_map)
+        munmap(ring->cq_map, ring->cq_map_size);
+    if (ring->sq_map && ring->sq_map != MAP_FAILED)
+        munmap(ring->sq_map, ring->sq_map_size);
+    if (ring->fd >= 0)
+        close(ring->fd);
+    free(ring);
+}
+static ReaderRing *reader_ring_open(unsigned entries)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0)
+        return NULL;
+    ReaderRing *ring = calloc(1, sizeof(ReaderRing));
+    ring->fd = fd;
+    ring->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    int single = 0;
+#ifdef IORING_FEAT_SINGLE_MMAP
+    single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+#endif
+    if (single && ring->cq_map_size > ring->sq_map_size)
+        ring->sq_map_size = ring->cq_map_size;
+    ring->sq_map = mmap(NULL, ring->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                        IORING_OFF_SQ_RING);
+    ring->cq_map = single ? ring->sq_map
+                          : mmap(NULL, ring->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                                 IORING_OFF_CQ_RING);
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ring->sq_map == MAP_FAILED || ring->cq_map == MAP_FAILED || ring->sqes == MAP_FAILED)
+    {
+        reader_ring_close(ring);
+        return NULL;
+    }
+    char *sq = ring->sq_map;
+    char *cq = ring->cq_map;
+    ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    return ring;
+}
+// queues a read of whatever part of the slot's file is still missing.
+static void reader_ring_read(ReaderRing *ring, ReaderSlot *slot, size_t index)
+{
+    size_t want = slot->file.length - slot->done;
+    slot->iov.iov_base = slot->file.data + slot->done;
+    slot->iov.iov_len = want < READER_MAX_READ ? want : READER_MAX_READ;
+    unsigned tail = *ring->sq_tail;
+    unsigned at = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[at];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = slot->fd;
+    sqe->addr = (uint64_t)(uintptr_t)&slot->iov;
+    sqe->len = 1;
+    sqe->off = slot->done;
+    sqe->user_data = index;
+    ring->sq_array[at] = at;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->to_submit++;
+}
+// submits what is queued and waits for one completion; -1 when the ring itself stopped working.
+static int reader_ring_wait(ReaderRing *ring, struct io_uring_cqe *cqe)
+{
+    for (;;)
+    {
+        unsigned head = *ring->cq_head;
+        if (head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+        {
+            *cqe = ring->cqes[head & *ring->cq_mask];
+            __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+            return 0;
+        }
+        long submitted = syscall(__NR_io_uring_enter, ring->fd, ring->to_submit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (submitted < 0 && errno == EINTR)
+            continue;
+        if (submitted < 0)
+            return -1;
+        ring->to_submit -= (unsigned)submitted;
+    }
+}
+static int reader_ring_next(Reader *reader, ReaderFile *file)
+{
+    ReaderRing *ring = reader->ring;
+    for (;;)
+    {
+        // reads already queued are finished by hand once the ring breaks, and so is everything after them.
+        if (ring->failed)
+        {
+            for (size_t i = 0; i < reader->depth; i++)
+            {
+                ReaderSlot *slot = &reader->slots[i];
+                if (slot->fd < 0)
+                    continue;
+                reader_finish(&slot->file, slot->fd, slot->done);
+                slot->fd = -1;
+                reader->in_flight--;
+                reader->delivered++;
+                *file = slot->file;
+                return 1;
+            }
+            int fd;
+            reader_open(reader->paths[reader->next++], file, &fd);
+            reader_finish(file, fd, 0);
+            reader->delivered++;
+            return 1;
+        }
+        while (reader->in_flight < reader->depth && reader->next < reader->count)
+        {
+            size_t index = 0;
+            while (reader->slots[index].fd >= 0)
+                index++;
+            ReaderSlot *slot = &reader->slots[index];
+            reader_open(reader->paths[reader->next++], &slot->file, &slot->fd);
+            if (slot->fd < 0 || slot->file.length == 0)
+            {
+                if (slot->fd >= 0)
+                    close(slot->fd);
+                slot->fd = -1;
+                reader->delivered++;
+                *file = slot->file;
+                return 1;
+            }
+            slot->done = 0;
+            reader->in_flight++;
+            reader_ring_read(ring, slot, index);
+        }
+
+        struct io_uring_cqe cqe;
+        if (reader_ring_wait(ring, &cqe) != 0)
+        {
+            ring->failed = 1;
+            continue;
+        }
+        ReaderSlot *slot = &reader->slots[cqe.user_data];
+        if (cqe.res == -EINTR || cqe.res == -EAGAIN)
+        {
+            reader_ring_read(ring, slot, (size_t)cqe.user_data);
+            continue;
+        }
+        if (cqe.res < 0)
+            reader_fail(&slot->file, -cqe.res);
+        else if (cqe.res == 0)
+        {
+            slot->file.length = slot->done;
+            slot->file.data[slot->done] = '\0';
+        }
+        else
+        {
+            slot->done += (size_t)cqe.res;
+            if (slot->done < slot->file.length)
+            {
+                reader_ring_read(ring, slot, (size_t)cqe.user_data);
+                continue;
+            }
+        }
+        close(slot->fd);
+        slot->fd = -1;
+        reader->in_flight--;
+        reader->delivered++;
+        *file = slot->file;
+        return 1;
+    }
+}
+// the kernel may still write into buffers of reads nobody took, so they are waited for before being freed.
+static void reader_ring_stop(Reader *reader)
+{
+    ReaderRing *ring = reader->ring;
+    while (reader->in_flight > 0 && !ring->failed)
+    {
+        struct io_uring_cqe cqe;
+        if (reader_ring_wait(ring, &cqe) != 0)
+            break;
+        ReaderSlot *slot = &reader->slots[cqe.user_data];
+        close(slot->fd);
+        slot->fd = -1;
+        free(slot->file.data);
+        reader->in_flight--;
+    }
+    for (size_t i = 0; i < reader->depth; i++)
+    {
+        if (reader->slots[i].fd < 0)
+            continue;
+        close(reader->slots[i].fd);
+        if (ring->failed)
+            free(reader->slots[i].file.data);
+    }
+    reader_ring_close(ring);
+}
+#else
+struct ReaderRing
+{
+    int failed;
+};
+static ReaderRing *reader_ring_open(unsigned entries)
+{
+    (void)entries;
+    return NULL;
+}
+static int reader_ring_next(Reader *reader, ReaderFile *file)
+{
+    (void)reader;
+    (void)file;
+    return 0;
+}
+static void reader_ring_stop(Reader *reader)
+{
+    (void)reader;
+}
+#endif
+
+Reader *init_reader(char **paths, size_t count, size_t depth, ReaderBackend backend)
+{
+    Reader *reader = calloc(1, sizeof(Reader));
+    reader->paths = paths;
+    reader->count = count;
+    reader->depth = depth ? depth : READER_DEFAULT_DEPTH;
+    if (backend != READER_POOL)
+        reader->ring = reader_ring_open((unsigned)reader->depth);
+    if (reader->ring)
+    {
+        reader->backend = READER_URING;
+        reader->slots = calloc(reader->depth, sizeof(ReaderSlot));
+        for (size_t i = 0; i < reader->depth; i++)
+            reader->slots[i].fd = -1;
+    }
+    else
+        reader_pool_start(reader);
+    return reader;
+}
+int reader_next(Reader *reader, ReaderFile *file)
+{
+    if (reader->delivered >= reader->count)
+        return 0;
+    if (reader->backend == READER_URING)
+        return reader_ring_next(reader, file);
+    return reader_pool_next(reader, file);
+}
+void reader_free(Reader *reader)
+{
+    if (reader == NULL)
+        return;
+    if (reader->backend == READER_URING)
+        reader_ring_stop(reader);
+    else
+        reader_pool_stop(reader);
+    free(reader->slots);
+    free(reader);
+}
+
+typedef struct
+{
+    char **items;
+    size_t count;
+    size_t capacity;
+} ReaderList;
+
+static void reader_list_push(ReaderList *list, char *path)
+{
+    if (list->count == list->capacity)
+    {
+        list->capacity = list->capacity ? list->capacity * 2 : 16;
+        list->items = realloc(list->items, list->capacity * sizeof(char *));
+    }
+    list->items[list->count++] = path;
+}
+// anything that is not a directory is kept as given, so a missing file still reports its error.
+static void reader_list_walk(ReaderList *list, const char *path)
+{
+    struct stat st;
+    DIR *dir = stat(path, &st) == 0 && S_ISDIR(st.st_mode) ? opendir(path) : NULL;
+    if (dir == NULL)
+    {
+        reader_list_push(list, strdup(path));
+        return;
+    }
+    size_t length = strlen(path);
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            continue;
+        size_t name_length = strlen(entry->d_name);
+        char *child = malloc(length + name_length + 2);
+        memcpy(child, path, length);
+        size_t at = length;
+        if (at == 0 || path[at - 1] != '/')
+            child[at++] = '/';
+        memcpy(child + at, entry->d_name, name_length + 1);
+        // a link is followed to a file but never into a directory, so a cycle of links cannot be walked.
+        if (lstat(child, &st) != 0)
+            st.st_mode = 0;
+        if (S_ISLNK(st.st_mode) && stat(child, &st) == 0 && S_ISDIR(st.st_mode))
+            st.st_mode = 0;
+        if (S_ISREG(st.st_mode))
+        {
+            reader_list_push(list, child);
+            continue;
+        }
+        if (S_ISDIR(st.st_mode))
+            reader_list_walk(list, child);
+        free(child);
+    }
+    closedir(dir);
+}
+char **reader_list(char **paths, size_t count, size_t *out_count)
+{
+    ReaderList list = {0};
+    for (size_t i = 0; i < count; i++)
+        reader_list_walk(&list, paths[i]);
+    *out_count = list.count;
+    return list.items;
+}
+void reader_list_free(char **paths, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        free(paths[i]);
+    free(paths);
+}
@@ -0,0 +1,370 @@
+#define _GNU_SOURCE
+#include "serve.h"
+#include "lexer.h"
+#include "parser.h"
+#include "arena.h"
+#include "strbuf.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+typedef struct ServeConn ServeConn;
+struct ServeConn
+{
+    int fd;
+    int eof;
+    StrBuf in;
+    ServeConn *next;
+};
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    ServeConn *head;
+    ServeConn *tail;
+    int stopping;
+    int epoll_fd;
+    ServeOptions *options;
+} ServeQueue;
+
+typedef struct
+{
+    ServeQueue *queue;
+    pthread_t thread;
+    Lexer *lexer;
+    Parser *parser;
+    Arena *arena;
+    StrBuf source;
+    StrBuf out;
+} ServeWorker;
+
+static volatile sig_atomic_t serve_stop = 0;
+
+static void serve_on_signal(int signal)
+{
+    (void)signal;
+    serve_stop = 1;
+}
+static uint32_t serve_read_u32(const char *p)
+{
+    const unsigned char *u = (const unsigned char *)p;
+    return (uint32_t)u[0] << 24 | (uint32_t)u[1] << 16 | (uint32_t)u[2] << 8 | (uint32_t)u[3];
+}
+static void serve_write_u32(char *p, uint32_t value)
+{
+    p[0] = (char)(value >> 24);
+    p[1] = (char)(value >> 16);
+    p[2] = (char)(value >> 8);
+    p[3] = (char)value;
+}
+// 1 when a whole request is buffered, 0 when more bytes are needed, -1 when it is oversized.
+static int serve_request_ready(ServeConn *conn)
+{
+    if (conn->in.length < SERVE_HEADER_SIZE)
+        return 0;
+    uint32_t length = serve_read_u32(conn->in.data);
+    if (length > SERVE_MAX_REQUEST)
+        return -1;
+    return conn->in.length >= SERVE_HEADER_SIZE + (size_t)length;
+}
+static void serve_conn_free(ServeConn *conn)
+{
+    close(conn->fd);
+    strbuf_free(&conn->in);
+    free(conn);
+}
+static int serve_arm(int epoll_fd, ServeConn *conn, int op)
+{
+    struct epoll_event event = {
+        .events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT,
+        .data.ptr = conn,
+    };
+    return epoll_ctl(epoll_fd, op, conn->fd, &event);
+}
+static void serve_enqueue(ServeQueue *queue, ServeConn *conn)
+{
+    pthread_mutex_lock(&queue->lock);
+    conn->next = NULL;
+    if (queue->tail)
+        queue->tail->next = conn;
+    else
+        queue->head = conn;
+    queue->tail = conn;
+    pthread_cond_signal(&queue->ready);
+    pthread_mutex_unlock(&queue->lock);
+}
+static ServeConn *serve_dequeue(ServeQueue *queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    while (queue->head == NULL && !queue->stopping)
+        pthread_cond_wait(&queue->ready, &queue->lock);
+    ServeConn *conn = queue->head;
+    if (conn)
+    {
+        queue->head = conn->next;
+        if (queue->head == NULL)
+            queue->tail = NULL;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return conn;
+}
+static long serve_millis(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+// -1 on errors and when the whole response is not taken within SERVE_WRITE_TIMEOUT_MS.
+static int serve_write_all(int fd, const char *data, size_t length)
+{
+    long deadline = serve_millis() + SERVE_WRITE_TIMEOUT_MS;
+    while (length > 0)
+    {
+        ssize_t written = send(fd, data, length, MSG_NOSIGNAL);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                struct pollfd pfd = {.fd = fd, .events = POLLOUT};
+                long remaining = deadline - serve_millis();
+                if (remaining <= 0 || poll(&pfd, 1, (int)remaining) == 0)
+                    return -1;
+                continue;
+            }
+            return -1;
+        }
+        data += written;
+        length -= (size_t)written;
+    }
+    return 0;
+}
+static void serve_handle(ServeWorker *worker, const char *request, size_t length)
+{
+    ServeOptions *options = worker->queue->options;
+    unsigned char format = (unsigned char)request[4];
+    unsigned char status = SERVE_STATUS_OK;
+    StrBuf *out = &worker->out;
+
+    strbuf_reset(out);
+    strbuf_append(out, "\0\0\0\0\0", SERVE_HEADER_SIZE);
+    if (format != SERVE_FORMAT_JSON && format != SERVE_FORMAT_CBOR)
+    {
+        status = SERVE_STATUS_BAD_REQUEST;
+        strbuf_puts(out, "unsupported format");
+    }
+    else
+    {
+        strbuf_reset(&worker->source);
+        strbuf_append(&worker->source, request + SERVE_HEADER_SIZE, length);
+        lexer_reset(worker->lexer, worker->source.data, "<request>");
+        parser_reset(worker->parser, worker->lexer);
+        AST *ast = parser_parse(worker->parser);
+        if (worker->parser->had_error)
+        {
+            status = worker->parser->limit ? SERVE_STATUS_LIMIT : SERVE_STATUS_PARSE_ERROR;
+            for (size_t i = 0; i < array_size(&worker->parser->diagnostics); i++)
+            {
+                ParserDiagnostic *diagnostic = &array_at(&worker->parser->diagnostics, i);
+                strbuf_printf(out, "%zu:%zu %s\n", diagnostic->row, diagnostic->col, diagnostic->message);
+            }
+        }
+        else if (format == SERVE_FORMAT_CBOR)
+            ast_write_cbor(out, ast, &options->cbor);
+        else
+            ast_write_json(out, ast, &options->json);
+        arena_reset(worker->arena);
+    }
+    serve_write_u32(out->data, (uint32_t)(out->length - SERVE_HEADER_SIZE));
+    out->data[4] = (char)status;
+}
+static void *serve_worker_main(void *arg)
+{
+    ServeWorker *worker = arg;
+    ServeQueue *queue = worker->queue;
+    ast_use_arena(worker->arena);
+    ServeConn *conn;
+    while ((conn = serve_dequeue(queue)) != NULL)
+    {
+        int failed = 0;
+        int ready = 0;
+        while (!failed && (ready = serve_request_ready(conn)) == 1)
+        {
+            size_t length = serve_read_u32(conn->in.data);
+            serve_handle(worker, conn->in.data, length);
+            failed = serve_write_all(conn->fd, worker->out.data, worker->out.length) != 0;
+            size_t consumed = SERVE_HEADER_SIZE + length;
+            memmove(conn->in.data, conn->in.data + consumed, conn->in.length - consumed);
+            conn->in.length -= consumed;
+        }
+        if (failed || ready < 0 || conn->eof || serve_arm(queue->epoll_fd, conn, EPOLL_CTL_MOD) != 0)
+            serve_conn_free(conn);
+    }
+    ast_use_arena(NULL);
+    return NULL;
+}
+static void serve_accept(ServeQueue *queue, int listen_fd)
+{
+    for (;;)
+    {
+        int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            return;
+        ServeConn *conn = calloc(1, sizeof(ServeConn));
+        conn->fd = fd;
+        conn->in = init_strbuf();
+        if (serve_arm(queue->epoll_fd, conn, EPOLL_CTL_ADD) != 0)
+            serve_conn_free(conn);
+    }
+}
+// reads no further than the end of the first whole request, so a client cannot grow the buffer past
+// SERVE_HEADER_SIZE + SERVE_MAX_REQUEST; the header is checked as soon as it is in.
+static void serve_read(ServeQueue *queue, ServeConn *conn)
+{
+    int ready;
+    while ((ready = serve_request_ready(conn)) == 0)
+    {
+        size_t limit = SERVE_HEADER_SIZE + SERVE_MAX_REQUEST;
+        if (conn->in.length >= SERVE_HEADER_SIZE)
+            limit = SERVE_HEADER_SIZE + (size_t)serve_read_u32(conn->in.data);
+        strbuf_reserve(&conn->in, 64 * 1024);
+        size_t room = conn->in.capacity - conn->in.length - 1;
+        if (room > limit - conn->in.length)
+            room = limit - conn->in.length;
+        ssize_t got = read(conn->fd, conn->in.data + conn->in.length, room);
+        if (got > 0)
+        {
+            conn->in.length += (size_t)got;
+            continue;
+        }
+        if (got == 0)
+            conn->eof = 1;
+        else if (errno == EINTR)
+            continue;
+        else if (errno != EAGAIN && errno != EWOULDBLOCK)
+            conn->eof = 1;
+        break;
+    }
+    if (ready == 1)
+        serve_enqueue(queue, conn);
+    else if (ready < 0 || conn->eof || serve_arm(queue->epoll_fd, conn, EPOLL_CTL_MOD) != 0)
+        serve_conn_free(conn);
+}
+static int serve_listen(const char *socket_path)
+{
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(socket_path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "[ERROR] socket path \"%s\" is too long.\n", socket_path);
+        return -1;
+    }
+    strcpy(addr.sun_path, socket_path);
+    struct stat st;
+    if (stat(socket_path, &st) == 0 && S_ISSOCK(st.st_mode))
+        unlink(socket_path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0)
+    {
+        fprintf(stderr, "[ERROR] cannot listen on \"%s\": %s.\n", socket_path, strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+    return fd;
+}
+int serve_run(const char *socket_path, ServeOptions *options)
+{
+    int listen_fd = serve_listen(socket_path);
+    if (listen_fd < 0)
+        return 1;
+
+    struct sigaction action = {.sa_handler = serve_on_signal};
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    ServeQueue queue = {
+        .epoll_fd = epoll_create1(EPOLL_CLOEXEC),
+        .options = options,
+    };
+    pthread_mutex_init(&queue.lock, NULL);
+    pthread_cond_init(&queue.ready, NULL);
+    struct epoll_event listen_event = {.events = EPOLLIN, .data.ptr = NULL};
+    epoll_ctl(queue.epoll_fd, EPOLL_CTL_ADD, listen_fd, &listen_event);
+
+    int count = options->workers > 0 ? options->workers : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (count < 1)
+        count = 1;
+    ServeWorker *workers = calloc((size_t)count, sizeof(ServeWorker));
+    for (int i = 0; i < count; i++)
+    {
+        ServeWorker *worker = &workers[i];
+        worker->queue = &queue;
+        worker->lexer = init_lexer("", "<request>");
+        worker->parser = init_parser(worker->lexer);
+        if (options->hashcons)
+            parser_enable_hashcons(worker->parser);
+        parser_set_limits(worker->parser, options->limits);
+        worker->arena = init_arena(0);
+        worker->source = init_strbuf();
+        worker->out = init_strbuf();
+        pthread_create(&worker->thread, NULL, serve_worker_main, worker);
+    }
+    fprintf(stderr, "[INFO] serving on \"%s\" with %d workers.\n", socket_path, count);
+
+    struct epoll_event events[64];
+    while (!serve_stop)
+    {
+        int n = epoll_wait(queue.epoll_fd, events, 64, -1);
+        for (int i = 0; i < n; i++)
+        {
+            if (events[i].data.ptr == NULL)
+                serve_accept(&queue, listen_fd);
+            else
+                serve_read(&queue, events[i].data.ptr);
+        }
+    }
+
+    pthread_mutex_lock(&queue.lock);
+    queue.stopping = 1;
+    pthread_cond_broadcast(&queue.ready);
+    pthread_mutex_unlock(&queue.lock);
+    for (int i = 0; i < count; i++)
+    {
+        ServeWorker *worker = &workers[i];
+        pthread_join(worker->thread, NULL);
+        parser_free(worker->parser);
+        lexer_free(worker->lexer);
+        arena_free(worker->arena);
+        strbuf_free(&worker->source);
+        strbuf_free(&worker->out);
+    }
+    free(workers);
+    close(listen_fd);
+    close(queue.epoll_fd);
+    unlink(socket_path);
+    return 0;
+}
+#else
+int serve_run(const char *socket_path, ServeOptions *options)
+{
+    (void)options;
+    fprintf(stderr, "[ERROR] cannot serve on \"%s\": --serve needs epoll.\n", socket_path);
+    return 1;
+}
+#endif
\ No newline at end of file
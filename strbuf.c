@@ -0,0 +1,86 @@
+#include "strbuf.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+StrBuf init_strbuf(void)
+{
+    StrBuf buf = {
+        .data = NULL,
+        .length = 0,
+        .capacity = 0,
+    };
+    return buf;
+}
+void strbuf_reserve(StrBuf *buf, size_t extra)
+{
+    if (buf->length + extra + 1 <= buf->capacity)
+        return;
+    size_t capacity = buf->capacity == 0 ? 64 : buf->capacity;
+    while (capacity < buf->length + extra + 1)
+        capacity *= 2;
+    buf->data = realloc(buf->data, capacity);
+    assert(buf->data != NULL && "cannot allocate memory");
+    buf->capacity = capacity;
+}
+void strbuf_append(StrBuf *buf, const char *data, size_t length)
+{
+    strbuf_reserve(buf, length);
+    memcpy(buf->data + buf->length, data, length);
+    buf->length += length;
+    buf->data[buf->length] = '\0';
+}
+void strbuf_puts(StrBuf *buf, const char *str)
+{
+    strbuf_append(buf, str, strlen(str));
+}
+void strbuf_putc(StrBuf *buf, char c)
+{
+    strbuf_reserve(buf, 1);
+    buf->data[buf->length++] = c;
+    buf->data[buf->length] = '\0';
+}
+void strbuf_printf(StrBuf *buf, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    char small[128];
+    int needed = vsnprintf(small, sizeof(small), format, args);
+    va_end(args);
+    if (needed < 0)
+        return;
+    if ((size_t)needed < sizeof(small))
+    {
+        strbuf_append(buf, small, (size_t)needed);
+        return;
+    }
+    strbuf_reserve(buf, (size_t)needed);
+    va_start(args, format);
+    vsnprintf(buf->data + buf->length, (size_t)needed + 1, format, args);
+    va_end(args);
+    buf->length += (size_t)needed;
+}
+void strbuf_reset(StrBuf *buf)
+{
+    buf->length = 0;
+    if (buf->data)
+        buf->data[0] = '\0';
+}
+char *strbuf_detach(StrBuf *buf)
+{
+    if (buf->data == NULL)
+    {
+        strbuf_reserve(buf, 0);
+        buf->data[0] = '\0';
+    }
+    char *data = buf->data;
+    *buf = init_strbuf();
+    return data;
+}
+void strbuf_free(StrBuf *buf)
+{
+    free(buf->data);
+    *buf = init_strbuf();
+}
@@ -0,0 +1,57 @@
+#include "token_stream.h"
+#include "lexer.h"
+#include "strbuf.h"
+#include <stdint.h>
+#include <string.h>
+
+size_t lexer_write_tokens(Lexer *lexer, StrBuf *out, StrBuf *errors)
+{
+    // offsets are 32 bits wide.
+    if (lexer->src_size > UINT32_MAX)
+        return SIZE_MAX;
+    size_t start = out->length;
+    TokenStreamHeader header = {
+        .magic = TOKEN_STREAM_MAGIC,
+        .version = TOKEN_STREAM_VERSION,
+        .type_count = GRAMMAR_TOKEN_COUNT,
+        .source_size = (uint32_t)lexer->src_size,
+    };
+    strbuf_append(out, (const char *)&header, sizeof(header));
+    size_t error_count = 0;
+    for (;;)
+    {
+        Token token = lexer_next_token(lexer);
+        if (token.type == TOKEN_EOF)
+            break;
+        TokenRecord record = {
+            .offset = (uint32_t)(token.start - lexer->src),
+            .length = (uint32_t)token.length,
+            .type = (uint32_t)token.type,
+        };
+        // reserved and copied by hand; strbuf_append would also rewrite the terminator for every token.
+        strbuf_reserve(out, sizeof(record));
+        memcpy(out->data + out->length, &record, sizeof(record));
+        out->length += sizeof(record);
+        header.token_count++;
+        if (token.type != TOKEN_ERROR)
+            continue;
+        error_count++;
+        if (errors)
+            strbuf_printf(errors, "LexerError at %s:%zu:%zu %s\n", lexer->file_path ? lexer->file_path : "<input>",
+                          token.row, token.col, token.message ? token.message : "unexpected character");
+    }
+    // the lexer only counts '\n' as a line break, and so does the table.
+    uint32_t line = 0;
+    strbuf_append(out, (const char *)&line, sizeof(line));
+    header.line_count = 1;
+    const char *src = lexer->src;
+    const char *end = src + lexer->src_size;
+    for (const char *newline = src; (newline = memchr(newline, '\n', (size_t)(end - newline))) != NULL;)
+    {
+        line = (uint32_t)(++newline - src);
+        strbuf_append(out, (const char *)&line, sizeof(line));
+        header.line_count++;
+    }
+    memcpy(out->data + start, &header, sizeof(header));
+    return error_count;
+}
@@ -0,0 +1,30 @@
+#!/usr/bin/env python3
+# Prints the cached powers of ten used by dtoa.c: 10^k for k = -348, -340, ..., 340
+# as a normalized 64-bit significand (rounded to nearest) and a binary exponent.
+from fractions import Fraction
+
+def cached_power(k):
+    value = Fraction(10) ** k
+    e = value.numerator.bit_length() - value.denominator.bit_length() - 64
+    while value / Fraction(2) ** e >= 2 ** 64:
+        e += 1
+    while value / Fraction(2) ** e < 2 ** 63:
+        e -= 1
+    scaled = value / Fraction(2) ** e
+    f = scaled.numerator // scaled.denominator
+    if scaled - f >= Fraction(1, 2):
+        f += 1
+    if f == 2 ** 64:
+        f //= 2
+        e += 1
+    return f, e
+
+powers = [cached_power(k) for k in range(-348, 341, 8)]
+print("static const uint64_t dtoa_cached_f[] = {")
+for i in range(0, len(powers), 4):
+    print("    " + ", ".join("0x%016xULL" % f for f, _ in powers[i:i + 4]) + ",")
+print("};")
+print("static const int16_t dtoa_cached_e[] = {")
+for i in range(0, len(powers), 10):
+    print("    " + ", ".join("%d" % e for _, e in powers[i:i + 10]) + ",")
+print("};")
@@ -0,0 +1,177 @@
+#!/usr/bin/env python3
+# Generates includes/grammar.h and grammar.c from grammar.spec: the token and precedence enums with
+# their names, the operator DFA and keyword hash used by lexer.c, and the PARSER_RULES table.
+import sys
+
+def fail(line_no, message):
+    sys.exit("grammar.spec:%d: %s" % (line_no, message))
+
+def parse(path):
+    tokens, ops, keywords, precs, rules = [], {}, {}, [], []
+    for line_no, line in enumerate(open(path, encoding="utf-8"), 1):
+        fields = line.split("#")[0].split()
+        if not fields:
+            continue
+        kind, args = fields[0], fields[1:]
+        if kind == "token" and len(args) == 1:
+            tokens.append(args[0])
+        elif kind == "op" and len(args) == 2:
+            if args[1] in ops.values():
+                fail(line_no, "operator %s is defined twice" % args[1])
+            tokens.append(args[0])
+            ops[args[0]] = args[1]
+        elif kind == "keyword" and len(args) in (2, 3) and args[2:] in ([], ["stmt"]):
+            tokens.append(args[0])
+            keywords[args[0]] = (args[1], len(args) == 3)
+        elif kind == "prec" and len(args) == 1:
+            precs.append(args[0])
+        elif kind == "rule" and len(args) == 5 and args[4] in ("left", "right"):
+            if args[0] not in tokens:
+                fail(line_no, "rule for unknown token %s" % args[0])
+            if args[3] not in precs:
+                fail(line_no, "unknown precedence %s" % args[3])
+            rules.append(args)
+        else:
+            fail(line_no, "cannot read %r" % line.strip())
+        if len(set(tokens)) != len(tokens):
+            fail(line_no, "token %s is defined twice" % tokens[-1])
+    return tokens, ops, keywords, precs, rules
+
+# a trie over the operator texts as nested dicts; the "" key holds the token of the operator ending there.
+def operator_trie(ops):
+    trie = {}
+    for name, text in ops.items():
+        node = trie
+        for c in text:
+            node = node.setdefault(c, {})
+        node[""] = name
+    return trie
+
+# the trie as nested switches, one per byte, so the compiler sees it as straight-line code; longest match wins.
+def operator_code(node, depth, fallback, indent):
+    if "" in node:
+        fallback = (node[""], depth)
+    children = sorted(c for c in node if c)
+    pad = "    " * indent
+    out = []
+    if children:
+        out.append(pad + "switch (length > %d ? text[%d] : '\\0')" % (depth, depth))
+        out.append(pad + "{")
+        for c in children:
+            out.append(pad + "case %s:" % c_char(c))
+            out += operator_code(node[c], depth + 1, fallback, indent + 1)
+        out += [pad + "default:", pad + "    break;", pad + "}"]
+    if fallback:
+        out += [pad + "*type = TOKEN_%s;" % fallback[0], pad + "return %d;" % fallback[1]]
+    else:
+        out.append(pad + "return 0;")
+    return out
+
+# a slot from the first and last byte and the length; searches for multipliers without collisions.
+def keyword_hash(keywords):
+    texts = [text for text, _ in keywords.values()]
+    size = 1
+    while size < 2 * len(texts):
+        size *= 2
+    while True:
+        for a in range(1, 256):
+            for b in range(0, 256):
+                slots = {(ord(t[0]) * a + ord(t[-1]) * b + len(t)) & (size - 1) for t in texts}
+                if len(slots) == len(texts):
+                    return size, a, b
+        size *= 2
+
+def c_string(text):
+    return '"' + text.replace("\\", "\\\\").replace('"', '\\"') + '"'
+
+def c_char(c):
+    return "'\\%s'" % c if c in "\\'" else "'%s'" % c
+
+def header(tokens, ops, keywords, precs, rules):
+    out = ["// generated by tools/gen_grammar.py from grammar.spec, do not edit.",
+           "#ifndef GRAMMAR_H", "#define GRAMMAR_H", "#include <stddef.h>", "#include <string.h>", "", "typedef enum", "{"]
+    out += ["    TOKEN_%s," % t for t in tokens]
+    out += ["} TokenType;", "", "typedef enum", "{"]
+    out += ["    PREC_%s," % p for p in precs]
+    out += ["} Precedence;", "", "typedef enum", "{", "    GRAMMAR_ASSOC_LEFT,", "    GRAMMAR_ASSOC_RIGHT,",
+            "} Associativity;", ""]
+    out.append("#define GRAMMAR_TOKEN_COUNT %d" % len(tokens))
+    out.append("#define GRAMMAR_PRECEDENCE_COUNT %d" % len(precs))
+    out.append("#define GRAMMAR_STMT_KEYWORD_COUNT %d" % sum(stmt for _, stmt in keywords.values()))
+    out.append("")
+    out.append("// X(token, prefix, infix, precedence, associativity); tokens left out have no rule at all.")
+    entries = []
+    for name, prefix, infix, prec, assoc in rules:
+        entries.append("X(TOKEN_%s, parser_parse_%s, parser_parse_%s, PREC_%s, GRAMMAR_ASSOC_%s)" %
+                       (name, "no_prefix" if prefix == "-" else prefix, "no_infix" if infix == "-" else infix,
+                        prec, assoc.upper()))
+    width = max(len(e) for e in entries) + 4
+    out.append("#define PARSER_RULES(X)".ljust(width + 4) + "\\")
+    for i, entry in enumerate(entries):
+        line = "    " + entry
+        out.append(line.ljust(width + 4) + "\\" if i + 1 < len(entries) else line)
+    size, a, b = keyword_hash(keywords)
+    lengths = [len(text) for text, _ in keywords.values()]
+    out += ["", "extern const char *const grammar_token_names[GRAMMAR_TOKEN_COUNT];",
+            "extern const char *const grammar_precedence_names[GRAMMAR_PRECEDENCE_COUNT];",
+            "extern const char *const grammar_stmt_keywords[GRAMMAR_STMT_KEYWORD_COUNT];",
+            "",
+            "typedef struct",
+            "{", "    const char *text;", "    size_t length;", "    TokenType type;", "} GrammarKeyword;",
+            "",
+            "// the lookups below run once per token, so they stay inline and only the table lives in grammar.c.",
+            "extern const GrammarKeyword grammar_keywords[%d];" % size,
+            "",
+            "// TOKEN_ID when text is not a keyword.",
+            "static inline TokenType grammar_keyword(const char *text, size_t length)",
+            "{",
+            "    if (length < %d || length > %d)" % (min(lengths), max(lengths)),
+            "        return TOKEN_ID;",
+            "    size_t slot = ((size_t)(unsigned char)text[0] * %d + (size_t)(unsigned char)text[length - 1] * %d + "
+            "length) & %d;" % (a, b, size - 1),
+            "    const GrammarKeyword *keyword = &grammar_keywords[slot];",
+            "    if (keyword->length == length && memcmp(keyword->text, text, length) == 0)",
+            "        return keyword->type;",
+            "    return TOKEN_ID;",
+            "}",
+            "// length of the longest operator text starts with, 0 when there is none.",
+            "static inline size_t grammar_operator(const char *text, size_t length, TokenType *type)",
+            "{"]
+    out += operator_code(operator_trie(ops), 0, None, 1)
+    out += ["}",
+            "#endif", ""]
+    return "\n".join(out)
+
+def source(tokens, ops, keywords, precs, rules):
+    size, a, b = keyword_hash(keywords)
+    out = ["// generated by tools/gen_grammar.py from grammar.spec, do not edit.", '#include "grammar.h"', ""]
+    out.append("const char *const grammar_token_names[GRAMMAR_TOKEN_COUNT] = {")
+    out += ['    "TOKEN_%s",' % t for t in tokens]
+    out += ["};", "const char *const grammar_precedence_names[GRAMMAR_PRECEDENCE_COUNT] = {"]
+    out += ['    "PREC_%s",' % p for p in precs]
+    out += ["};", "const char *const grammar_stmt_keywords[GRAMMAR_STMT_KEYWORD_COUNT] = {"]
+    out += ["    %s," % c_string(text) for text, stmt in keywords.values() if stmt]
+    out += ["};", ""]
+
+    slots = [None] * size
+    for name, (text, _) in keywords.items():
+        slots[(ord(text[0]) * a + ord(text[-1]) * b + len(text)) & (size - 1)] = (name, text)
+    out.append("const GrammarKeyword grammar_keywords[%d] = {" % size)
+    for slot in slots:
+        if slot:
+            out.append("    {%s, %d, TOKEN_%s}," % (c_string(slot[1]), len(slot[1]), slot[0]))
+        else:
+            out.append("    {NULL, 0, TOKEN_ID},")
+    out += ["};", ""]
+    return "\n".join(out)
+
+if __name__ == "__main__":
+    spec = sys.argv[1] if len(sys.argv) > 1 else "grammar.spec"
+    header_path = sys.argv[2] if len(sys.argv) > 2 else "includes/grammar.h"
+    source_path = sys.argv[3] if len(sys.argv) > 3 else "grammar.c"
+    grammar = parse(spec)
+    # the header is written last so make sees it as newer than grammar.c.
+    with open(source_path, "w") as f:
+        f.write(source(*grammar))
+    with open(header_path, "w") as f:
+        f.write(header(*grammar))
@@ -0,0 +1,27 @@
+#!/usr/bin/env python3
+# Prints the non-ASCII XID_Start and XID_Continue ranges used by utf8.c, taken from the
+# Unicode database of the running Python (str.isidentifier follows UAX #31 with these properties).
+import sys
+import unicodedata
+
+def ranges(accept):
+    out = []
+    start = None
+    for cp in range(0x80, sys.maxunicode + 2):
+        ok = cp <= sys.maxunicode and accept(chr(cp))
+        if ok and start is None:
+            start = cp
+        elif not ok and start is not None:
+            out.append((start, cp - 1))
+            start = None
+    return out
+
+def emit(name, table):
+    print("static const uint32_t %s[][2] = {" % name)
+    for i in range(0, len(table), 4):
+        print("    " + " ".join("{0x%05X, 0x%05X}," % r for r in table[i:i + 4]))
+    print("};")
+
+print("// Unicode %s" % unicodedata.unidata_version)
+emit("utf8_xid_start", ranges(lambda c: c.isidentifier()))
+emit("utf8_xid_continue", ranges(lambda c: ("a" + c).isidentifier()))